@@ -0,0 +1,169 @@
+#include <openai/openai.hpp>
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <tuple>
+
+// Body size and encode time of typical requests, as sent by the library
+//  and with every member written (the baseline, before the API defaults were left out)
+
+// A request serialized with every member, defaults included
+template<typename Request>
+struct FullBody {
+  const Request &request;
+};
+
+template<typename T>
+std::optional<T> always(const T &value) {
+  return value;
+}
+
+namespace daw::json {
+  template<>
+  struct json_data_contract<FullBody<openai::models::CompletionsRequest>> {
+    using type = json_data_contract<openai::models::CompletionsRequest>::type;
+
+    static inline auto to_json_data(FullBody<openai::models::CompletionsRequest> const &body) {
+      const auto &value = body.request;
+      return std::make_tuple(std::cref(value.model),
+                             std::cref(value.prompt),
+                             &value.suffix,
+                             always(value.max_tokens),
+                             always(value.temperature),
+                             always(value.top_p),
+                             always(value.n),
+                             std::cref(value.logprobs),
+                             always(value.echo),
+                             std::cref(value.stop),
+                             always(value.presence_penalty),
+                             always(value.frequency_penalty),
+                             always(value.best_of),
+                             &value.user,
+                             std::cref(value.logit_bias),
+                             std::cref(value.seed));
+    }
+  };
+
+  template<>
+  struct json_data_contract<FullBody<openai::models::ChatCompletionRequest>> {
+    using type = json_data_contract<openai::models::ChatCompletionRequest>::type;
+
+    static inline auto to_json_data(FullBody<openai::models::ChatCompletionRequest> const &body) {
+      const auto &value = body.request;
+      return std::make_tuple(std::cref(value.model),
+                             std::cref(value.messages),
+                             always(value.temperature),
+                             always(value.top_p),
+                             always(value.n),
+                             std::cref(value.stop),
+                             always(value.stream),
+                             std::cref(value.max_tokens),
+                             always(value.presence_penalty),
+                             always(value.frequency_penalty),
+                             &value.user,
+                             std::cref(value.logit_bias),
+                             std::cref(value.seed));
+    }
+  };
+
+  template<>
+  struct json_data_contract<FullBody<openai::models::EditsRequest>> {
+    using type = json_data_contract<openai::models::EditsRequest>::type;
+
+    static inline auto to_json_data(FullBody<openai::models::EditsRequest> const &body) {
+      const auto &value = body.request;
+      return std::make_tuple(std::cref(value.model),
+                             std::cref(value.input),
+                             std::cref(value.instruction),
+                             always(value.n),
+                             always(value.temperature),
+                             always(value.top_p));
+    }
+  };
+
+  template<>
+  struct json_data_contract<FullBody<openai::models::EmbeddingRequest>> {
+    using type = json_data_contract<openai::models::EmbeddingRequest>::type;
+
+    static inline auto to_json_data(FullBody<openai::models::EmbeddingRequest> const &body) {
+      const auto &value = body.request;
+      return std::make_tuple(std::cref(value.model), std::cref(value.input), &value.user);
+    }
+  };
+
+  template<>
+  struct json_data_contract<FullBody<openai::models::ImagesGenerationsRequest>> {
+    using type = json_data_contract<openai::models::ImagesGenerationsRequest>::type;
+
+    static inline auto to_json_data(FullBody<openai::models::ImagesGenerationsRequest> const &body) {
+      const auto &value = body.request;
+      return std::make_tuple(std::cref(value.prompt),
+                             always(value.n),
+                             &value.size,
+                             &value.response_format,
+                             &value.user);
+    }
+  };
+}
+
+template<typename Body>
+void measure(const std::string &name, const Body &body, size_t iterations) {
+  size_t bytes = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    bytes += daw::json::to_json(body).size();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  const auto ns = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+
+  std::cout << std::left << std::setw(32) << name
+            << std::right << std::setw(8) << bytes / iterations << " bytes"
+            << std::setw(10) << std::fixed << std::setprecision(1) << ns << " ns/request" << std::endl;
+  std::cout << "  " << daw::json::to_json(body) << std::endl;
+}
+
+template<typename Request>
+void benchmark(const std::string &name, const Request &request, size_t iterations = 200000) {
+  measure(name + " (full body)", FullBody<Request>{request}, iterations);
+  measure(name, request, iterations);
+}
+
+int main() {
+  auto completions = openai::models::get_default_completions_request();
+  completions.prompt = "Give me a good punchline for a ice cream shop!";
+  benchmark("completions", completions);
+
+  completions.temperature = 0.2;
+  completions.stop = std::vector<std::string>{"\n", "."};
+  completions.user = "user-1234";
+  benchmark("completions (tuned)", completions);
+
+  openai::models::ChatCompletionRequest chat{};
+  chat.model = to_str(openai::AI_MODELS::GPT3Dot5Turbo);
+  chat.messages = {{to_str(openai::CHAT_ROLES::user), "Hello ChatGPT! My name is Dimitri"}};
+  chat.temperature = 1;
+  chat.top_p = 1;
+  chat.n = 1;
+  benchmark("chat", chat);
+
+  auto edits = openai::models::get_default_edits_request();
+  edits.input = "What day of the wek is it?";
+  edits.instruction = "Fix the spelling mistakes";
+  benchmark("edits", edits);
+
+  openai::models::EmbeddingRequest embedding;
+  embedding.model = "text-embedding-ada-002";
+  embedding.input = "The food was delicious and the waiter...";
+  benchmark("embeddings", embedding);
+
+  openai::models::ImagesGenerationsRequest image;
+  image.prompt = "a white siamese cat";
+  image.n = 1;
+  image.size = to_str(openai::IMAGE_SIZE::px_1024_1024);
+  image.response_format = to_str(openai::IMAGE_RESPONSE_FORMAT::url);
+  benchmark("images", image);
+}
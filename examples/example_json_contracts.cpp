@@ -0,0 +1,94 @@
+#include <openai/openai.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Parses the JSON documents of assets/json with the response contracts, checks the members
+//  the API sends as null or leaves out, and that serializing and parsing again gives the same document.
+// Run from the root of the repository, exits with 1 when a check fails.
+
+int failures = 0;
+
+std::string read_file(std::string_view path) {
+  std::ifstream file(std::string(path), std::ios::binary);
+  return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+bool check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cerr << "failed: " << what << std::endl;
+    ++failures;
+  }
+  return ok;
+}
+
+template<typename T>
+T round_trip(const std::string &path) {
+  const auto json = read_file(path);
+  check(!json.empty(), path + " is missing");
+
+  auto value = daw::json::from_json<T>(json);
+  const auto serialized = daw::json::to_json(value);
+  check(daw::json::to_json(daw::json::from_json<T>(serialized)) == serialized, path + " round trip");
+  return value;
+}
+
+void fine_tune() {
+  const auto job = round_trip<openai::models::FineTune>("assets/json/fine_tune.json");
+  check(job.status == "pending", "fine_tune.status");
+  check(!job.fine_tuned_model, "fine_tune.fine_tuned_model is null");
+  check(job.hyperparams.batch_size == 4, "fine_tune.hyperparams.batch_size");
+  if (check(job.training_files.size() == 1, "fine_tune.training_files")) {
+    check(!job.training_files[0].status_details, "fine_tune.training_files[0].status_details is null");
+  }
+  check(job.events && job.events->size() == 2, "fine_tune.events");
+  check(job.events && job.events->back().message == "Job started.", "fine_tune.events[1].message");
+}
+
+void fine_tunes() {
+  const auto list = round_trip<openai::models::ListFineTune>("assets/json/fine_tunes.json");
+  if (!check(list.data.size() == 2, "fine_tunes.data")) {
+    return;
+  }
+  const auto &succeeded = list.data[0];
+  check(succeeded.fine_tuned_model == "curie:ft-acmeco-2021-03-03-21-44-20", "fine_tunes[0].fine_tuned_model");
+  check(!succeeded.events, "fine_tunes[0].events is left out");
+  check(succeeded.result_files.size() == 1, "fine_tunes[0].result_files");
+  const auto &pending = list.data[1];
+  check(!pending.fine_tuned_model, "fine_tunes[1].fine_tuned_model is null");
+  check(!pending.hyperparams.batch_size && !pending.hyperparams.learning_rate_multiplier,
+        "fine_tunes[1].hyperparams are null");
+  check(pending.hyperparams.n_epochs == 4, "fine_tunes[1].hyperparams.n_epochs");
+}
+
+void fine_tune_events() {
+  const auto events = round_trip<openai::models::ListFineTuneEvents>("assets/json/fine_tune_events.json");
+  check(events.data.size() == 1, "fine_tune_events.data");
+}
+
+void files() {
+  const auto list = round_trip<openai::models::ListFilesResponse>("assets/json/files.json");
+  if (!check(list.data.size() == 2, "files.data")) {
+    return;
+  }
+  check(!list.data[0].status_details, "files[0].status_details is null");
+  check(list.data[1].status == "error" && list.data[1].status_details, "files[1].status_details");
+}
+
+int main() {
+  try {
+    fine_tune();
+    fine_tunes();
+    fine_tune_events();
+    files();
+  } catch (const std::exception &exc) {
+    std::cerr << "failed: " << exc.what() << std::endl;
+    return 1;
+  }
+
+  if (failures > 0) {
+    return 1;
+  }
+  std::cout << "JSON contracts: ok" << std::endl;
+}
@@ -1,20 +1,70 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
 #include <daw/json/daw_json_link.h>
-#include "openai/api_utils.hpp"
 #include "../lib/httplib.hpp"
+#include "openai/errors.hpp"
+#include "openai/http/body_buffer.hpp"
+#include "openai/http/client_pool.hpp"
+#include "openai/http/concurrency_limiter.hpp"
+#include "openai/http/deadline_timer.hpp"
+#include "openai/http/hedging.hpp"
+#include "openai/http/latency_tracker.hpp"
+#include "openai/http/load_balancer.hpp"
+#include "openai/http/multipart.hpp"
+#include "openai/http/request_options.hpp"
+#include "openai/models/commons.hpp"
 
 namespace openai {
   namespace http {
+    // Sends one request on the given client.
+    // A hedgeable request must own everything it references: its duplicate can outlive the call that created it.
+    using RequestFn = std::function<httplib::Result(httplib::Client &client, const httplib::Headers &headers)>;
+
     class HttpClient {
-      httplib::Client *client;
-      httplib::Headers headers;
+      std::shared_ptr<LoadBalancer> balancer;
+
+      LatencyTracker latencies;
+      HedgingPolicy hedging_policy;
+      HedgingBudget hedging_budget;
+      std::shared_ptr<ConcurrencyLimiter> limiter;
+      // timers of the StopScope of the calls in flight
+      DeadlineTimer deadlines;
 
      public:
-      explicit HttpClient(const std::string &domain, httplib::Headers headers) : headers(std::move(headers)) {
-        this->client = new httplib::Client(domain);
+      explicit HttpClient(const std::string &domain, httplib::Headers headers) {
+        this->balancer = std::make_shared<LoadBalancer>(std::vector<Target>{{domain, std::move(headers)}});
+      }
+
+      // Spread the requests over several targets (API keys, organizations, proxies)
+      explicit HttpClient(const std::vector<Target> &targets,
+                          LOAD_BALANCING_STRATEGY strategy = least_outstanding_requests,
+                          HealthPolicy health_policy = {}) {
+        this->balancer = std::make_shared<LoadBalancer>(targets, strategy, std::move(health_policy));
+      }
+
+      // Enable or tune hedged requests. Must be called before sending requests.
+      void set_hedging_policy(const HedgingPolicy &policy) {
+        this->hedging_policy = policy;
+      }
+
+      // Bound the number of calls in flight over every thread, 0 for no limit.
+      // Calls over the limit wait for a slot, up to their deadline. Must be called before sending requests.
+      void set_max_concurrent_requests(size_t max_concurrent_requests) {
+        this->limiter = max_concurrent_requests == 0 ? nullptr : std::make_shared<ConcurrencyLimiter>(max_concurrent_requests);
       }
 
       // parsing json
@@ -26,86 +76,559 @@ namespace openai {
         return std::move(obj);
       }
 
+      // Turn the result of a call into the parsed response, or into the reason it failed.
+      // `query_body` is copied into the Error of a rejected call.
       template<typename Ret>
-      Ret parse_http_response(httplib::Result *result,
-                              const std::string &path,
-                              const std::string *query_body = nullptr) {
-        if (result->error() != httplib::Error::Success) {
-          throw std::runtime_error(httplib::to_string(result->error()));
+      Expected<Ret> parse_http_response(Expected<httplib::Result> &&sent,
+                                        const std::string &path,
+                                        std::string_view query_body = {}) {
+        if (!sent) {
+          return std::move(sent).error();
+        }
+
+        auto &result = *sent;
+        if (result.error() != httplib::Error::Success) {
+          Error error;
+          error.kind = error_transport;
+          error.path = path;
+          error.transport_error = result.error();
+          return error;
         }
 
-        auto const value = result->value();
+        auto &value = result.value();
         if (value.status == 200) {
           try {
             if constexpr (std::is_same<Ret, std::string>::value) {
-              return value.body;
+              return std::move(value.body);
+            } else {
+              return parse_response_content<Ret>(value.body);
             }
-            return parse_response_content<Ret>(value.body);
           } catch (const std::exception &exc) {
-            throw std::runtime_error(
-                "exception: " + std::string{exc.what()} +
-                    "\nurl is: " + path +
-                    "\nResponse body is:\n" + value.body
-            );
+            Error error;
+            error.kind = error_parse;
+            error.status = value.status;
+            error.path = path;
+            error.detail = exc.what();
+            error.body = std::move(value.body);
+            return error;
           }
         }
 
-        if (query_body != nullptr) {
-          throw std::runtime_error(
-              "Response status not success: " + std::to_string(value.status) +
-                  "\nurl is: " + path +
-                  "\nQuery body:\n" + *query_body +
-                  "\nResponse body:\n" + value.body);
-        } else {
-          throw std::runtime_error(
-              "Response status not success: " + std::to_string(value.status) +
-                  "\nurl is: " + path +
-                  "\nResponse body is:\n" + value.body);
+        Error error;
+        error.kind = error_http_status;
+        error.status = value.status;
+        error.path = path;
+        error.body = std::move(value.body);
+        if (!query_body.empty()) {
+          error.query_body = std::make_shared<const std::string>(query_body);
+        }
+        return error;
+      }
+
+      // Keep the body of a successful call alive and parse it into a view model pointing into it
+      template<typename View>
+      Expected<std::unique_ptr<models::Retained<View>>> retain(Expected<std::string> &&body, const std::string &path) {
+        if (!body) {
+          return std::move(body).error();
+        }
+
+        auto retained = std::make_unique<models::Retained<View>>(std::move(body).value());
+        try {
+          retained->value = parse_response_content<View>(retained->body);
+        } catch (const std::exception &exc) {
+          Error error;
+          error.kind = error_parse;
+          error.status = 200;
+          error.path = path;
+          error.detail = exc.what();
+          error.body = retained->body;
+          return error;
         }
+        return retained;
       }
 
+      // Parse the body of a successful call with every string and vector allocated from `resource`,
+      //  eg: the models::pmr responses
+      template<typename Ret>
+      Expected<Ret> parse_alloc(Expected<std::string> &&body,
+                                const std::string &path,
+                                std::pmr::memory_resource *resource) {
+        if (!body) {
+          return std::move(body).error();
+        }
+
+        try {
+          return daw::json::from_json_alloc<Ret>(
+              *body,
+              std::pmr::polymorphic_allocator<char>(resource),
+              daw::json::options::parse_flags<daw::json::options::UseExactMappingsByDefault::no,
+                                              daw::json::options::CheckedParseMode::no>);
+        } catch (const std::exception &exc) {
+          Error error;
+          error.kind = error_parse;
+          error.status = 200;
+          error.path = path;
+          error.detail = exc.what();
+          error.body = std::move(*body);
+          return error;
+        }
+      }
+
+      // The try_ methods return the error instead of throwing it
+
       // GET
       template<typename Ret>
-      Ret get(const std::string &path) {
-        auto result = this->client->Get(path, headers);
-        return parse_http_response<Ret>(&result, path);
+      Expected<Ret> try_get(const std::string &path, const RequestOptions &options = {}) {
+        auto result = this->send(path, [path](httplib::Client &client, const httplib::Headers &headers) {
+          return client.Get(path, headers);
+        }, true, options);
+        return parse_http_response<Ret>(std::move(result), path);
+      }
+
+      // GET parsed into a view model, which points into the retained response body
+      template<typename View>
+      Expected<std::unique_ptr<models::Retained<View>>> try_get_view(const std::string &path,
+                                                                    const RequestOptions &options = {}) {
+        return this->retain<View>(this->try_get<std::string>(path, options), path);
+      }
+
+      // GET parsed into a response allocated from `resource`
+      template<typename Ret>
+      Expected<Ret> try_get_alloc(const std::string &path,
+                                  std::pmr::memory_resource *resource,
+                                  const RequestOptions &options = {}) {
+        return this->parse_alloc<Ret>(this->try_get<std::string>(path, options), path, resource);
+      }
+
+      template<typename Ret>
+      Ret get(const std::string &path, const RequestOptions &options = {}) {
+        return this->try_get<Ret>(path, options).value();
       }
 
       // POST without body
       template<typename Ret>
-      Ret post(const std::string &path) {
+      Expected<Ret> try_post(const std::string &path, const RequestOptions &options = {}) {
         // req
-        auto result = this->client->Post(path, headers);
+        auto result = this->send(path, [path](httplib::Client &client, const httplib::Headers &headers) {
+          return client.Post(path, headers);
+        }, false, options);
         // parse
-        return parse_http_response<Ret>(&result, path);
+        return parse_http_response<Ret>(std::move(result), path);
+      }
+
+      template<typename Ret>
+      Ret post(const std::string &path, const RequestOptions &options = {}) {
+        return this->try_post<Ret>(path, options).value();
       }
 
       // POST + JSON body
       template<typename Input, typename Ret>
-      Ret post(const std::string &path, const Input &data, const std::string &content_type = "application/json") {
-        // parse json
-        const auto body = daw::json::to_json(data);
+      Expected<Ret> try_post(const std::string &path,
+                             const Input &data,
+                             const RequestOptions &options = {},
+                             const std::string &content_type = "application/json") {
+        const bool hedgeable = this->hedging_policy.endpoints.count(endpoint_key(path)) > 0;
+        if (hedgeable && this->hedging_policy.enabled) {
+          // a duplicate can outlive this call: it owns a copy of the body
+          auto body = std::make_shared<const std::string>(daw::json::to_json(data));
+          auto result = this->send(path, [path, body, content_type](httplib::Client &client,
+                                                                    const httplib::Headers &headers) {
+            return client.Post(path, headers, *body, content_type);
+          }, true, options);
+          return parse_http_response<Ret>(std::move(result), path, *body);
+        }
+
+        // parse json into the buffer of this thread, sent from there without a copy
+        BodyBuffer buffer;
+        auto &body = buffer.get();
+        daw::json::to_json(data, std::back_inserter(body));
+        const std::string_view view = body;
         // req
-        auto result = this->client->Post(path, headers, body, content_type);
+        auto result = this->send(path, [&path, view, &content_type](httplib::Client &client,
+                                                                    const httplib::Headers &headers) {
+          return client.Post(path, headers, view.size(),
+                             [view](size_t offset, size_t length, httplib::DataSink &sink) {
+                               return sink.write(view.data() + offset, std::min(length, view.size() - offset));
+                             },
+                             content_type);
+        }, false, options);
         // parse
-        return parse_http_response<Ret>(&result, path, &body);
+        return parse_http_response<Ret>(std::move(result), path, view);
+      }
+
+      template<typename Input, typename Ret>
+      Ret post(const std::string &path,
+               const Input &data,
+               const RequestOptions &options = {},
+               const std::string &content_type = "application/json") {
+        return this->try_post<Input, Ret>(path, data, options, content_type).value();
+      }
+
+      // POST + JSON body, the response parsed into a view model which points into the retained response body
+      template<typename Input, typename View>
+      Expected<std::unique_ptr<models::Retained<View>>> try_post_view(const std::string &path,
+                                                                     const Input &data,
+                                                                     const RequestOptions &options = {}) {
+        return this->retain<View>(this->try_post<Input, std::string>(path, data, options), path);
+      }
+
+      // POST + JSON body, the response allocated from `resource`
+      template<typename Input, typename Ret>
+      Expected<Ret> try_post_alloc(const std::string &path,
+                                   const Input &data,
+                                   std::pmr::memory_resource *resource,
+                                   const RequestOptions &options = {}) {
+        return this->parse_alloc<Ret>(this->try_post<Input, std::string>(path, data, options), path, resource);
       }
 
       // POST + Multipart
       template<typename Ret>
-      Ret post(const std::string &path, const httplib::MultipartFormDataItems &data_items) {
+      Expected<Ret> try_post(const std::string &path,
+                             const httplib::MultipartFormDataItems &data_items,
+                             const RequestOptions &options = {}) {
         // req
-        auto result = this->client->Post(path, headers, data_items);
+        auto result = this->send(path, [&path, &data_items](httplib::Client &client, const httplib::Headers &headers) {
+          return client.Post(path, headers, data_items);
+        }, false, options);
         // parse
-        return parse_http_response<Ret>(&result, path);
+        return parse_http_response<Ret>(std::move(result), path);
+      }
+
+      template<typename Ret>
+      Ret post(const std::string &path,
+               const httplib::MultipartFormDataItems &data_items,
+               const RequestOptions &options = {}) {
+        return this->try_post<Ret>(path, data_items, options).value();
+      }
+
+      // POST + streamed Multipart
+      template<typename Ret>
+      Expected<Ret> try_post(const std::string &path,
+                             std::shared_ptr<MultipartBody> body,
+                             const RequestOptions &options = {}) {
+        body->finish();
+        // req
+        auto result = this->send(path, [path, body](httplib::Client &client, const httplib::Headers &headers) {
+          return client.Post(path, headers, body->content_length(),
+                             [body](size_t offset, size_t length, httplib::DataSink &sink) {
+                               return body->provide(offset, length, sink);
+                             },
+                             body->content_type());
+        }, false, options);
+        // parse
+        return parse_http_response<Ret>(std::move(result), path);
+      }
+
+      template<typename Ret>
+      Ret post(const std::string &path, std::shared_ptr<MultipartBody> body, const RequestOptions &options = {}) {
+        return this->try_post<Ret>(path, std::move(body), options).value();
+      }
+
+      // GET streaming the body to `on_data` as it is received, instead of buffering it.
+      // `on_response` is called once with the status and headers before the body, for 200 and 206 responses only.
+      // Any callback returning false cancels the transfer. Returns the HTTP status (200 or 206).
+      Expected<int> try_get_stream(const std::string &path,
+                                   const httplib::Headers &extra_headers,
+                                   const httplib::ResponseHandler &on_response,
+                                   const httplib::ContentReceiver &on_data,
+                                   const httplib::Progress &on_progress = nullptr,
+                                   const RequestOptions &options = {}) {
+        bool streaming = false;
+        std::string error_body;
+
+        auto result = this->send(path, [&](httplib::Client &client, const httplib::Headers &headers) {
+          auto all_headers = headers;
+          all_headers.insert(extra_headers.begin(), extra_headers.end());
+          streaming = false;
+          error_body.clear();
+
+          return client.Get(path, all_headers,
+                            [&](const httplib::Response &response) {
+                              streaming = response.status == 200 || response.status == 206;
+                              return !streaming || !on_response || on_response(response);
+                            },
+                            [&](const char *data, size_t length) {
+                              if (streaming) {
+                                return on_data(data, length);
+                              }
+                              // keep the error body for the Error
+                              error_body.append(data, length);
+                              return true;
+                            },
+                            [&](uint64_t current, uint64_t total) {
+                              return !streaming || !on_progress || on_progress(current, total);
+                            });
+        }, false, options);
+
+        if (!result) {
+          return std::move(result).error();
+        }
+
+        if (result->error() != httplib::Error::Success) {
+          Error error;
+          error.kind = error_transport;
+          error.path = path;
+          error.transport_error = result->error();
+          return error;
+        }
+
+        const auto status = (*result)->status;
+        if (status == 200 || status == 206) {
+          return status;
+        }
+        Error error;
+        error.kind = error_http_status;
+        error.path = path;
+        error.status = status;
+        error.body = std::move(error_body);
+        return error;
       }
 
       // DELETE
       template<typename Ret>
-      Ret delete_(const std::string &path) {
-        auto result = this->client->Delete(path, headers);
-        return parse_http_response<Ret>(&result, path);
+      Expected<Ret> try_delete_(const std::string &path, const RequestOptions &options = {}) {
+        auto result = this->send(path, [path](httplib::Client &client, const httplib::Headers &headers) {
+          return client.Delete(path, headers);
+        }, false, options);
+        return parse_http_response<Ret>(std::move(result), path);
+      }
+
+      template<typename Ret>
+      Ret delete_(const std::string &path, const RequestOptions &options = {}) {
+        return this->try_delete_<Ret>(path, options).value();
+      }
+
+      // Bound the connection and every socket operation of the next request by the deadline.
+      // The call as a whole is stopped by a StopScope once the deadline passes.
+      // Pooled clients are shared between calls, so the defaults are restored when there is no deadline.
+      static void apply_timeouts(httplib::Client &client,
+                                 const std::optional<std::chrono::steady_clock::time_point> &deadline) {
+        using namespace std::chrono;
+        const auto connection = seconds(CPPHTTPLIB_CONNECTION_TIMEOUT_SECOND) + microseconds(CPPHTTPLIB_CONNECTION_TIMEOUT_USECOND);
+        const auto read = seconds(CPPHTTPLIB_READ_TIMEOUT_SECOND) + microseconds(CPPHTTPLIB_READ_TIMEOUT_USECOND);
+        const auto write = seconds(CPPHTTPLIB_WRITE_TIMEOUT_SECOND) + microseconds(CPPHTTPLIB_WRITE_TIMEOUT_USECOND);
+
+        if (!deadline) {
+          client.set_connection_timeout(connection);
+          client.set_read_timeout(read);
+          client.set_write_timeout(write);
+          return;
+        }
+
+        const auto remaining = std::max<microseconds>(duration_cast<microseconds>(*deadline - steady_clock::now()),
+                                                      microseconds(1000));
+        client.set_connection_timeout(std::min<microseconds>(connection, remaining));
+        client.set_read_timeout(std::min<microseconds>(read, remaining));
+        client.set_write_timeout(std::min<microseconds>(write, remaining));
+      }
+
+     private:
+      // The call was aborted by the caller: a content receiver, response handler or progress returned false
+      static bool is_aborted(const httplib::Result &result) {
+        return !result && result.error() == httplib::Error::Canceled;
+      }
+
+      // The target did not handle the call: worth counting against its health
+      static bool is_target_failure(const httplib::Result &result) {
+        if (!result) {
+          return !is_aborted(result);
+        }
+        return result->status == 429 || result->status >= 500;
+      }
+
+      // The call can be sent again on another target
+      static bool should_failover(const httplib::Result &result, bool idempotent) {
+        if (!result) {
+          // the request never reached the upstream when the connection failed
+          return idempotent || result.error() == httplib::Error::Connection;
+        }
+        // 429 and 503 are rejected before any processing
+        return result->status == 429 || result->status == 503 || (idempotent && result->status >= 500);
+      }
+
+      static std::optional<Error> options_error(const RequestOptions &options) {
+        if (options.is_cancelled()) {
+          Error error;
+          error.kind = error_cancelled;
+          return error;
+        }
+        if (options.is_expired()) {
+          Error error;
+          error.kind = error_deadline_exceeded;
+          return error;
+        }
+        return std::nullopt;
+      }
+
+      // Send a request on a pooled connection of the best target, hedging it when the policy allows
+      //  and failing over to other targets when the target is failing.
+      // Fails with error_circuit_open when the circuit of the endpoint is open on every target tried,
+      //  error_cancelled or error_deadline_exceeded when the options stop the call.
+      // `hedgeable` must only be true when sending the request twice is harmless.
+      Expected<httplib::Result> send(const std::string &path,
+                                     RequestFn request,
+                                     bool hedgeable,
+                                     const RequestOptions &options) {
+        const auto endpoint = endpoint_key(path);
+
+        std::optional<ConcurrencyLimiter::Permit> permit;
+        if (this->limiter) {
+          permit = this->limiter->acquire(options);
+          if (!permit) {
+            return std::move(*options_error(options));
+          }
+        }
+
+        std::optional<std::chrono::microseconds> hedge_after;
+        if (hedgeable && this->hedging_policy.enabled) {
+          this->hedging_budget.on_request();
+          hedge_after = this->latencies.percentile(endpoint,
+                                                   this->hedging_policy.percentile,
+                                                   this->hedging_policy.min_samples);
+          if (hedge_after) {
+            hedge_after = std::max<std::chrono::microseconds>(*hedge_after, this->hedging_policy.min_delay);
+          }
+        }
+
+        const auto max_attempts = 1 + std::min(this->balancer->health_policy.max_failover, this->balancer->size() - 1);
+        TargetState *previous = nullptr;
+        for (size_t attempt = 1;; ++attempt) {
+          if (auto error = options_error(options)) {
+            return std::move(*error);
+          }
+
+          auto *target = this->balancer->pick(previous);
+          previous = target;
+
+          // fail fast instead of waiting on an upstream that is known to be failing
+          auto &breaker = target->breakers.get(endpoint);
+          if (!breaker.allow()) {
+            if (attempt >= max_attempts) {
+              Error error;
+              error.kind = error_circuit_open;
+              error.path = endpoint;
+              error.detail = target->pool->get_domain();
+              return error;
+            }
+            continue;
+          }
+
+          const auto start = std::chrono::steady_clock::now();
+          auto result = hedge_after ? this->send_hedged(request, target, *hedge_after, options)
+                                    : this->send_once(request, target, options);
+          if (!result && (options.is_cancelled() || options.is_expired())) {
+            // the failure is ours, not the upstream's: the call is not counted
+            breaker.release();
+            return std::move(*options_error(options));
+          }
+          if (is_aborted(result)) {
+            breaker.release();
+            return result;
+          }
+          breaker.record(is_target_failure(result));
+          if (result) {
+            this->latencies.record(endpoint, std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start));
+          }
+
+          if (attempt >= max_attempts || !is_target_failure(result) || !should_failover(result, hedgeable)) {
+            return result;
+          }
+        }
+      }
+
+      httplib::Result send_once(const RequestFn &request, TargetState *target, const RequestOptions &options) {
+        auto client = target->pool->acquire();
+        apply_timeouts(*client, options.deadline);
+        StopScope stop_scope(this->deadlines, options, [&client]() { client->stop(); });
+
+        target->begin();
+        auto result = request(*client, client.headers());
+        target->end(is_target_failure(result) && !options.is_cancelled(), this->balancer->health_policy);
+        return result;
+      }
+
+      // Run the request in the background, and if it has not answered after `hedge_after`
+      //  send a duplicate on another target or connection. The first response wins, the other one is stopped.
+      httplib::Result send_hedged(const RequestFn &request,
+                                  TargetState *target,
+                                  std::chrono::microseconds hedge_after,
+                                  const RequestOptions &options) {
+        struct Race {
+          std::mutex mutex;
+          std::condition_variable done;
+          std::optional<httplib::Result> winner;
+          std::vector<httplib::Client *> in_flight;
+          size_t running = 0;
+          bool cancelled = false;
+        };
+        auto race = std::make_shared<Race>();
+
+        auto launch = [race, &request, balancer = this->balancer, deadline = options.deadline](TargetState *target) {
+          {
+            std::lock_guard<std::mutex> lock(race->mutex);
+            race->running++;
+          }
+          std::thread([race, request, target, balancer, deadline]() {
+            auto client = target->pool->acquire();
+            apply_timeouts(*client, deadline);
+            {
+              std::lock_guard<std::mutex> lock(race->mutex);
+              if (race->winner || race->cancelled) {
+                race->running--;
+                if (race->running == 0 && !race->winner) {
+                  race->winner.emplace(nullptr, httplib::Error::Canceled);
+                  race->done.notify_all();
+                }
+                return;
+              }
+              race->in_flight.push_back(client.get());
+            }
+
+            target->begin();
+            auto result = request(*client, client.headers());
+
+            std::lock_guard<std::mutex> lock(race->mutex);
+            race->in_flight.erase(std::find(race->in_flight.begin(), race->in_flight.end(), client.get()));
+            race->running--;
+            // a stopped loser says nothing about the health of its target
+            target->end(!race->winner && !race->cancelled && is_target_failure(result), balancer->health_policy);
+            // a failed attempt only wins if there is nothing else left to wait for
+            if (!race->winner && (result || race->running == 0)) {
+              race->winner.emplace(std::move(result));
+              for (auto *loser : race->in_flight) {
+                loser->stop();
+              }
+              race->done.notify_all();
+            }
+          }).detach();
+        };
+
+        // cancelling, or reaching the deadline, stops every attempt: the last one to fail wakes us up
+        const auto stop = [&race]() {
+          std::lock_guard<std::mutex> lock(race->mutex);
+          race->cancelled = true;
+          for (auto *attempt : race->in_flight) {
+            attempt->stop();
+          }
+        };
+        StopScope stop_scope(this->deadlines, options, stop);
+
+        launch(target);
+
+        std::unique_lock<std::mutex> lock(race->mutex);
+        const auto has_winner = [&race]() { return race->winner.has_value(); };
+        if (!race->done.wait_for(lock, hedge_after, has_winner)) {
+          if (!race->cancelled && !options.is_expired() &&
+              this->hedging_budget.try_acquire(this->hedging_policy.max_extra_load)) {
+            lock.unlock();
+            launch(this->balancer->pick(target));
+            lock.lock();
+          }
+          race->done.wait(lock, has_winner);
+        }
+        return std::move(*race->winner);
       }
     };
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Vectorized decoding, picked at runtime on x86 (GCC/Clang) and at compile time elsewhere
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define OPENAI_BASE64_X86 1
+#include <immintrin.h>
+#elif defined(_M_X64) && defined(__AVX2__)
+#define OPENAI_BASE64_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define OPENAI_BASE64_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(OPENAI_BASE64_X86) && (defined(__GNUC__) || defined(__clang__))
+#define OPENAI_BASE64_TARGET(isa) __attribute__((target(isa)))
+#else
+#define OPENAI_BASE64_TARGET(isa)
+#endif
+
+namespace openai {
+  namespace base64 {
+    // Sextet of every base64 character, 0xff for the others
+    struct DecodeTable {
+      uint8_t values[256];
+
+      constexpr DecodeTable() : values() {
+        for (auto &value : this->values) {
+          value = 0xff;
+        }
+        for (int i = 0; i < 26; ++i) {
+          this->values['A' + i] = static_cast<uint8_t>(i);
+          this->values['a' + i] = static_cast<uint8_t>(26 + i);
+        }
+        for (int i = 0; i < 10; ++i) {
+          this->values['0' + i] = static_cast<uint8_t>(52 + i);
+        }
+        this->values['+'] = 62;
+        this->values['/'] = 63;
+      }
+    };
+
+    inline constexpr DecodeTable decode_table{};
+
+    // Decode what is left of the input, 4 characters at a time.
+    // Also accepts "\/", the JSON escaped '/', so it can run on raw JSON strings.
+    inline std::optional<size_t> decode_scalar(const char *in, size_t length, char *out) {
+      const auto *const start = out;
+      uint32_t quantum = 0;
+      int sextets = 0;
+      size_t i = 0;
+      for (; i < length; ++i) {
+        const auto c = static_cast<unsigned char>(in[i]);
+        if (c == '\\' && i + 1 < length && in[i + 1] == '/') {
+          continue;
+        }
+        if (c == '=') {
+          break;
+        }
+        const auto value = decode_table.values[c];
+        if (value == 0xff) {
+          return std::nullopt;
+        }
+        quantum = (quantum << 6) | value;
+        if (++sextets == 4) {
+          *out++ = static_cast<char>(quantum >> 16);
+          *out++ = static_cast<char>(quantum >> 8);
+          *out++ = static_cast<char>(quantum);
+          quantum = 0;
+          sextets = 0;
+        }
+      }
+
+      // padding, when present, completes the last quantum and ends the input
+      size_t padding = 0;
+      for (; i < length; ++i, ++padding) {
+        if (in[i] != '=') {
+          return std::nullopt;
+        }
+      }
+      if (padding != 0 && (sextets == 0 || sextets + padding != 4)) {
+        return std::nullopt;
+      }
+      switch (sextets) {
+        case 0:
+          break;
+        case 2:
+          *out++ = static_cast<char>(quantum >> 4);
+          break;
+        case 3:
+          *out++ = static_cast<char>(quantum >> 10);
+          *out++ = static_cast<char>(quantum >> 2);
+          break;
+        default:
+          return std::nullopt;
+      }
+      return static_cast<size_t>(out - start);
+    }
+
+    // The vectorized loops decode whole blocks and stop at the first block holding anything else
+    //  than base64 characters (padding, escapes or invalid data): the scalar decoder takes it from there.
+    // They keep 16 characters of margin at the end, as their stores write past the decoded bytes.
+
+#ifdef OPENAI_BASE64_X86
+    // Muła and Lemire, "Faster Base64 Encoding and Decoding Using AVX2 Instructions"
+    OPENAI_BASE64_TARGET("ssse3")
+    inline size_t decode_ssse3(const char *in, size_t length, char *out, size_t &written) {
+      const auto lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+      const auto lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+      const auto lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+      const auto mask_2f = _mm_set1_epi8(0x2f);
+      const auto shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+      size_t i = 0;
+      written = 0;
+      for (; i + 32 <= length; i += 16, written += 12) {
+        auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const auto hi_nibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), mask_2f);
+        const auto lo = _mm_shuffle_epi8(lut_lo, _mm_and_si128(chars, mask_2f));
+        const auto hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0) {
+          break;
+        }
+        const auto eq_2f = _mm_cmpeq_epi8(chars, mask_2f);
+        chars = _mm_add_epi8(chars, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles)));
+
+        // 4 x 6 bits -> 3 bytes
+        const auto merged = _mm_maddubs_epi16(chars, _mm_set1_epi32(0x01400140));
+        const auto packed = _mm_shuffle_epi8(_mm_madd_epi16(merged, _mm_set1_epi32(0x00011000)), shuffle);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + written), packed);
+      }
+      return i;
+    }
+
+    OPENAI_BASE64_TARGET("avx2")
+    inline size_t decode_avx2(const char *in, size_t length, char *out, size_t &written) {
+      const auto lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                           0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                           0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+      const auto lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                           0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                           0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+      const auto lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+      const auto mask_2f = _mm256_set1_epi8(0x2f);
+      const auto shuffle = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+      const auto compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+      size_t i = 0;
+      written = 0;
+      for (; i + 48 <= length; i += 32, written += 24) {
+        auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        const auto hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(chars, 4), mask_2f);
+        const auto lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(chars, mask_2f));
+        const auto hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        if (!_mm256_testz_si256(lo, hi)) {
+          break;
+        }
+        const auto eq_2f = _mm256_cmpeq_epi8(chars, mask_2f);
+        chars = _mm256_add_epi8(chars, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles)));
+
+        // 4 x 6 bits -> 3 bytes, then the 12 bytes of each lane side by side
+        const auto merged = _mm256_maddubs_epi16(chars, _mm256_set1_epi32(0x01400140));
+        auto packed = _mm256_shuffle_epi8(_mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000)), shuffle);
+        packed = _mm256_permutevar8x32_epi32(packed, compact);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + written), packed);
+      }
+      return i;
+    }
+#endif
+
+#ifdef OPENAI_BASE64_NEON
+    // Translate 16 characters to sextets, `invalid` collects the bits of the characters out of the alphabet
+    inline uint8x16_t neon_sextets(uint8x16_t chars, uint8x16_t &invalid) {
+      const auto upper = vandq_u8(vcgeq_u8(chars, vdupq_n_u8('A')), vcleq_u8(chars, vdupq_n_u8('Z')));
+      const auto lower = vandq_u8(vcgeq_u8(chars, vdupq_n_u8('a')), vcleq_u8(chars, vdupq_n_u8('z')));
+      const auto digit = vandq_u8(vcgeq_u8(chars, vdupq_n_u8('0')), vcleq_u8(chars, vdupq_n_u8('9')));
+      const auto plus = vceqq_u8(chars, vdupq_n_u8('+'));
+      const auto slash = vceqq_u8(chars, vdupq_n_u8('/'));
+
+      auto sextets = vdupq_n_u8(0xff);
+      sextets = vbslq_u8(upper, vsubq_u8(chars, vdupq_n_u8('A')), sextets);
+      sextets = vbslq_u8(lower, vsubq_u8(chars, vdupq_n_u8('a' - 26)), sextets);
+      sextets = vbslq_u8(digit, vaddq_u8(chars, vdupq_n_u8(52 - '0')), sextets);
+      sextets = vbslq_u8(plus, vdupq_n_u8(62), sextets);
+      sextets = vbslq_u8(slash, vdupq_n_u8(63), sextets);
+      invalid = vorrq_u8(invalid, sextets);
+      return sextets;
+    }
+
+    inline size_t decode_neon(const char *in, size_t length, char *out, size_t &written) {
+      size_t i = 0;
+      written = 0;
+      for (; i + 64 + 16 <= length; i += 64, written += 48) {
+        const auto chars = vld4q_u8(reinterpret_cast<const uint8_t *>(in + i));
+        auto invalid = vdupq_n_u8(0);
+        const auto a = neon_sextets(chars.val[0], invalid);
+        const auto b = neon_sextets(chars.val[1], invalid);
+        const auto c = neon_sextets(chars.val[2], invalid);
+        const auto d = neon_sextets(chars.val[3], invalid);
+        if (vmaxvq_u8(invalid) > 63) {
+          break;
+        }
+
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+        vst3q_u8(reinterpret_cast<uint8_t *>(out + written), bytes);
+      }
+      return i;
+    }
+#endif
+  }
+
+  // Upper bound of the number of bytes decoded from `in`
+  inline size_t base64_decoded_size(std::string_view in) {
+    return (in.size() + 3) / 4 * 3;
+  }
+
+  // Decode base64 from `in` to `out`, which must hold base64_decoded_size(in) bytes.
+  // `in` may be the raw content of a JSON string, such as b64_json in an image response.
+  // Returns the number of bytes written, nothing when `in` is not valid base64.
+  inline std::optional<size_t> base64_decode(std::string_view in, char *out) {
+    size_t consumed = 0;
+    size_t written = 0;
+
+#if defined(OPENAI_BASE64_X86) && (defined(__GNUC__) || defined(__clang__))
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+    if (has_avx2) {
+      consumed = base64::decode_avx2(in.data(), in.size(), out, written);
+    } else if (has_ssse3) {
+      consumed = base64::decode_ssse3(in.data(), in.size(), out, written);
+    }
+#elif defined(OPENAI_BASE64_X86)
+    consumed = base64::decode_avx2(in.data(), in.size(), out, written);
+#elif defined(OPENAI_BASE64_NEON)
+    consumed = base64::decode_neon(in.data(), in.size(), out, written);
+#endif
+
+    auto rest = base64::decode_scalar(in.data() + consumed, in.size() - consumed, out + written);
+    if (!rest) {
+      return std::nullopt;
+    }
+    return written + *rest;
+  }
+
+  inline std::optional<std::string> base64_decode(std::string_view in) {
+    std::string out(base64_decoded_size(in), '\0');
+    auto size = base64_decode(in, out.data());
+    if (!size) {
+      return std::nullopt;
+    }
+    out.resize(*size);
+    return out;
+  }
+}
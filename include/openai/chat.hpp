@@ -57,7 +57,7 @@ namespace openai {
     }
 
     // send a message
-    models::ChatCompletionsResponse *say(const std::string &text) {
+    models::ChatCompletionsResponse *say(const std::string &text, const http::RequestOptions &options = {}) {
       models::ChatCompletionRequest chat_request = this->new_default_request();
       models::ChatCompletionRequestMessage message;
       message.role = to_str(CHAT_ROLES::user);
@@ -65,12 +65,32 @@ namespace openai {
 
       chat_request.messages = std::vector<models::ChatCompletionRequestMessage>{message};
 
-      return this->send_message(chat_request);
+      return this->send_message(chat_request, options);
     }
 
     // send a message by specifying everything in the request
-    models::ChatCompletionsResponse *say(models::ChatCompletionRequest &chat_request) {
-      return this->send_message(chat_request);
+    models::ChatCompletionsResponse *say(models::ChatCompletionRequest &chat_request,
+                                         const http::RequestOptions &options = {}) {
+      return this->send_message(chat_request, options);
+    }
+
+    // Same as say, but returns the error instead of throwing it.
+    // The conversation history is left untouched on failure.
+    Expected<models::ChatCompletionsResponse *> try_say(const std::string &text,
+                                                        const http::RequestOptions &options = {}) {
+      models::ChatCompletionRequest chat_request = this->new_default_request();
+      models::ChatCompletionRequestMessage message;
+      message.role = to_str(CHAT_ROLES::user);
+      message.content = text;
+
+      chat_request.messages = std::vector<models::ChatCompletionRequestMessage>{message};
+
+      return this->try_send_message(chat_request, options);
+    }
+
+    Expected<models::ChatCompletionsResponse *> try_say(models::ChatCompletionRequest &chat_request,
+                                                        const http::RequestOptions &options = {}) {
+      return this->try_send_message(chat_request, options);
     }
 
     friend std::ostream &operator<<(std::ostream &os, const Chat &chat) {
@@ -82,14 +102,15 @@ namespace openai {
     }
 
     // send multiple messages
-    models::ChatCompletionsResponse *say(const std::vector<models::ChatCompletionRequestMessage> &new_messages) {
+    models::ChatCompletionsResponse *say(const std::vector<models::ChatCompletionRequestMessage> &new_messages,
+                                         const http::RequestOptions &options = {}) {
       models::ChatCompletionRequest chat_request = this->new_default_request();
       models::ChatCompletionRequestMessage message;
 
       chat_request.model = to_str(this->model);
       chat_request.messages = new_messages;
 
-      return this->send_message(chat_request);
+      return this->send_message(chat_request, options);
     }
 
    private:
@@ -108,23 +129,34 @@ namespace openai {
       return chat_request;
     }
 
-    models::ChatCompletionsResponse *send_message(models::ChatCompletionRequest &msg) {
+    models::ChatCompletionsResponse *send_message(models::ChatCompletionRequest &msg,
+                                                  const http::RequestOptions &options) {
+      return this->try_send_message(msg, options).value();
+    }
+
+    Expected<models::ChatCompletionsResponse *> try_send_message(models::ChatCompletionRequest &msg,
+                                                                 const http::RequestOptions &options) {
       if (msg.stream) {
         throw std::runtime_error("stream for chat is not enabled for now. Feel free to open a PR!");
       }
 
-      // add new message to message history
-      this->chat_history.insert(this->chat_history.end(), msg.messages.begin(), msg.messages.end());
-
-      // use message history as message source
-      msg.messages = this->chat_history;
+      // use message history + new messages as message source
+      const auto new_messages = msg.messages.size();
+      msg.messages.insert(msg.messages.begin(), this->chat_history.begin(), this->chat_history.end());
 
       auto response =
-          this->http_client->post<models::ChatCompletionRequest, models::ChatCompletionsResponse *>(
+          this->http_client->try_post<models::ChatCompletionRequest, models::ChatCompletionsResponse *>(
               "/v1/chat/completions",
-              msg
+              msg,
+              options
           );
-      const auto resp = response->choices[0].message;
+      if (!response) {
+        return response;
+      }
+
+      // add new messages and the answer to message history
+      this->chat_history.insert(this->chat_history.end(), msg.messages.end() - new_messages, msg.messages.end());
+      const auto resp = (*response)->choices[0].message;
       this->chat_history.push_back({.role = resp.role, .content = resp.content});
       return response;
     }
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <daw/json/daw_json_link.h>
+#include "openai/api_utils.hpp"
+#include "openai/http/coalescer.hpp"
+#include "openai/models/chat.hpp"
+
+namespace openai {
+  struct ChatBatcherOptions {
+    // How long the first caller of a batch waits for others to join it
+    std::chrono::microseconds window = std::chrono::milliseconds(5);
+    // Choices asked in one call, a full batch is sent right away
+    int64_t max_choices = 16;
+  };
+
+  // Generates chat completions for many threads with few calls.
+  // Concurrent requests identical but for `n` are merged into one call asking for the sum of their `n`,
+  //  and the choices are dealt back to the callers. The call is sent `window` after the first request
+  //  joined or once full, see http::Coalescer.
+  // Requests differing in anything else (messages, sampling, user...) are never merged.
+  //
+  // Eg:
+  //  auto batcher = api.new_chat_batcher();
+  //  // from any thread
+  //  auto choices = batcher->complete(request).value();
+  class ChatBatcher {
+   private:
+    // the request of a batch, and the choices its callers asked for
+    struct Merged {
+      models::ChatCompletionRequest request;
+      int64_t choices = 0;
+    };
+    // sorted by index
+    using Choices = std::vector<models::ChatCompletionResponseMessageWrapper>;
+
+    http::HttpClient *http_client;
+    ChatBatcherOptions options;
+
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> requests{0};
+
+    // batches by request without `n`
+    http::Coalescer<std::string, Merged, Choices> coalescer;
+
+   public:
+    explicit ChatBatcher(http::HttpClient *http_client, ChatBatcherOptions options = {})
+        : http_client(http_client),
+          options(std::move(options)),
+          coalescer("/v1/chat/completions", this->options.window, [this](Merged &batch, const http::RequestOptions &request_options) {
+            return this->send(batch, request_options);
+          }) {
+      this->options.max_choices = std::max<int64_t>(1, this->options.max_choices);
+    }
+
+    ChatBatcher(const ChatBatcher &) = delete;
+    ChatBatcher &operator=(const ChatBatcher &) = delete;
+
+    // The `request.n` choices of `request`, indexed from 0.
+    // Blocks for the batch window and the call.
+    Expected<std::vector<models::ChatCompletionResponseMessageWrapper>> complete(
+        const models::ChatCompletionRequest &request,
+        const http::RequestOptions &request_options = {}
+    ) {
+      if (request.stream) {
+        throw std::runtime_error("stream for chat is not enabled for now. Feel free to open a PR!");
+      }
+      ++this->requests;
+      const auto n = std::max<int64_t>(1, request.n);
+
+      // join the open batch if our choices fit, or open one
+      size_t offset = 0;
+      auto results = this->coalescer.submit(ChatBatcher::key(request), request_options, [&](Merged &batch) {
+        if (batch.choices > 0 && batch.choices + n > this->options.max_choices) {
+          return http::coalesce_no_room;
+        }
+        if (batch.choices == 0) {
+          batch.request = request;
+        }
+        offset = static_cast<size_t>(batch.choices);
+        batch.choices += n;
+        return batch.choices >= this->options.max_choices ? http::coalesce_full : http::coalesce_joined;
+      });
+      if (!results) {
+        return std::move(results).error();
+      }
+
+      const auto &batch_choices = **results;
+      std::vector<models::ChatCompletionResponseMessageWrapper> choices(
+          batch_choices.begin() + static_cast<std::ptrdiff_t>(offset),
+          batch_choices.begin() + static_cast<std::ptrdiff_t>(offset + static_cast<size_t>(n))
+      );
+      for (auto &choice : choices) {
+        choice.index -= static_cast<int64_t>(offset);
+      }
+      return choices;
+    }
+
+    // Calls sent, and requests received
+    uint64_t sent_calls() const { return this->calls; }
+
+    uint64_t received_requests() const { return this->requests; }
+
+   private:
+    // called by the coalescer without any lock held
+    Expected<Choices> send(Merged &batch, const http::RequestOptions &request_options) {
+      batch.request.n = batch.choices;
+
+      ++this->calls;
+      auto response = this->http_client->try_post<models::ChatCompletionRequest, models::ChatCompletionsResponse>(
+          "/v1/chat/completions", batch.request, request_options
+      );
+      if (!response) {
+        return std::move(response).error();
+      }
+      auto &choices = response->choices;
+      std::sort(choices.begin(), choices.end(), [](const auto &a, const auto &b) { return a.index < b.index; });
+      if (choices.size() != static_cast<size_t>(batch.choices)) {
+        Error error;
+        error.kind = error_parse;
+        error.status = 200;
+        error.path = "/v1/chat/completions";
+        error.detail = "expected " + std::to_string(batch.choices) + " choices, got " +
+            std::to_string(choices.size());
+        return error;
+      }
+      return std::move(choices);
+    }
+
+    // The request as sent, without `n`: requests with the same key can share a call
+    static std::string key(const models::ChatCompletionRequest &request) {
+      auto copy = request;
+      copy.n = 1;
+      return daw::json::to_json(copy);
+    }
+  };
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "openai/api_utils.hpp"
+#include "openai/models/completions.hpp"
+#include "openai/tokens.hpp"
+
+namespace openai {
+  struct CompletionsBatchOptions {
+    // prompts sent in one call
+    size_t max_prompts_per_request = 20;
+    // tokens of one call: the estimated prompt tokens plus `max_tokens * n` for every prompt, see estimate_tokens.
+    // A prompt over the budget on its own is sent alone.
+    size_t max_tokens_per_request = 16000;
+    // calls in flight
+    size_t max_concurrent_requests = 4;
+  };
+
+  struct CompletionsBatchResult {
+    // the `n` choices of the prompt, indexed from 0
+    std::vector<models::CompletionsResponseChoices> choices;
+    // set when the call of the prompt failed
+    std::optional<Error> error;
+  };
+
+  // Completes many prompts with few calls: the prompts are packed in arrays under a token budget,
+  //  the calls run in parallel and the choices are mapped back to their prompt.
+  //
+  // Eg:
+  //  auto results = api.get_completions_batch(prompts);
+  //  std::cout << results[42].choices[0].text << std::endl;
+  class CompletionsBatch {
+   private:
+    http::HttpClient *http_client;
+    CompletionsBatchOptions options;
+
+   public:
+    explicit CompletionsBatch(http::HttpClient *http_client, CompletionsBatchOptions options = {})
+        : http_client(http_client), options(std::move(options)) {
+      this->options.max_prompts_per_request = std::max<size_t>(1, this->options.max_prompts_per_request);
+      this->options.max_concurrent_requests = std::max<size_t>(1, this->options.max_concurrent_requests);
+    }
+
+    // One result per prompt, in order. `request` gives every parameter but the prompt.
+    // Blocks until every call is done.
+    std::vector<CompletionsBatchResult> run(const std::vector<std::string> &prompts,
+                                            const models::CompletionsRequest &request,
+                                            const http::RequestOptions &request_options = {}) {
+      std::vector<CompletionsBatchResult> results(prompts.size());
+      const auto chunks = this->plan(prompts, request);
+
+      std::atomic<size_t> next_chunk{0};
+      std::vector<std::thread> workers;
+      const auto concurrency = std::min(this->options.max_concurrent_requests, chunks.size());
+      for (size_t i = 0; i < concurrency; ++i) {
+        workers.emplace_back([&]() {
+          for (auto index = next_chunk++; index < chunks.size(); index = next_chunk++) {
+            this->complete(prompts, chunks[index].first, chunks[index].second, request, request_options, results);
+          }
+        });
+      }
+      for (auto &worker : workers) {
+        worker.join();
+      }
+      return results;
+    }
+
+   private:
+    // [begin, end) ranges of prompts sent together, in order
+    std::vector<std::pair<size_t, size_t>> plan(const std::vector<std::string> &prompts,
+                                                const models::CompletionsRequest &request) const {
+      const auto completion_tokens = static_cast<size_t>(std::max<int64_t>(0, request.max_tokens)) *
+          static_cast<size_t>(std::max<int64_t>(1, std::max(request.n, request.best_of)));
+
+      std::vector<std::pair<size_t, size_t>> chunks;
+      size_t begin = 0;
+      size_t tokens = 0;
+      for (size_t i = 0; i < prompts.size(); ++i) {
+        const auto prompt_tokens = estimate_tokens(prompts[i]) + completion_tokens;
+        const bool full = i - begin >= this->options.max_prompts_per_request ||
+            tokens + prompt_tokens > this->options.max_tokens_per_request;
+        if (i > begin && full) {
+          chunks.emplace_back(begin, i);
+          begin = i;
+          tokens = 0;
+        }
+        tokens += prompt_tokens;
+      }
+      if (begin < prompts.size()) {
+        chunks.emplace_back(begin, prompts.size());
+      }
+      return chunks;
+    }
+
+    // Complete prompts [begin, end) into their results
+    void complete(const std::vector<std::string> &prompts,
+                  size_t begin,
+                  size_t end,
+                  const models::CompletionsRequest &request,
+                  const http::RequestOptions &request_options,
+                  std::vector<CompletionsBatchResult> &results) {
+      auto chunk_request = request;
+      chunk_request.prompt = std::vector<std::string>(prompts.begin() + static_cast<std::ptrdiff_t>(begin),
+                                                      prompts.begin() + static_cast<std::ptrdiff_t>(end));
+      const auto n = static_cast<size_t>(std::max<int64_t>(1, request.n));
+
+      auto response = this->http_client->try_post<models::CompletionsRequest, models::CompletionsResponse>(
+          "/v1/completions", chunk_request, request_options
+      );
+      if (!response) {
+        for (auto i = begin; i < end; ++i) {
+          results[i].error = response.error();
+        }
+        return;
+      }
+
+      for (auto &choice : response->choices) {
+        if (choice.index < 0 || static_cast<size_t>(choice.index) >= (end - begin) * n) {
+          continue;
+        }
+        auto &result = results[begin + static_cast<size_t>(choice.index) / n];
+        choice.index %= static_cast<int64_t>(n);
+        result.choices.push_back(std::move(choice));
+      }
+      for (auto i = begin; i < end; ++i) {
+        auto &choices = results[i].choices;
+        std::sort(choices.begin(), choices.end(), [](const auto &a, const auto &b) { return a.index < b.index; });
+        if (choices.size() != n) {
+          Error error;
+          error.kind = error_parse;
+          error.status = 200;
+          error.path = "/v1/completions";
+          error.detail = "expected " + std::to_string(n) + " choices for prompt " + std::to_string(i) + ", got " +
+              std::to_string(choices.size());
+          results[i].error = std::move(error);
+        }
+      }
+    }
+  };
+}
@@ -0,0 +1,544 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "openai/http/multipart.hpp"
+#include "openai/tokens.hpp"
+
+namespace openai {
+  struct DatasetOptions {
+    // Maximum number of tokens of an example (prompt + completion), see estimate_tokens
+    size_t max_tokens = 2048;
+    // Report examples with the same prompt and completion as an earlier one
+    bool reject_duplicates = true;
+    // Stop recording errors after this many. Lines are still validated and counted
+    size_t max_errors = 1000;
+    // Number of threads, 0 to use every core
+    unsigned threads = 0;
+  };
+
+  struct DatasetError {
+    // 1-based line number
+    size_t line;
+    std::string message;
+  };
+
+  struct TokenStats {
+    size_t count = 0;
+    size_t min = 0;
+    size_t max = 0;
+    uint64_t total = 0;
+
+    double mean() const {
+      return this->count == 0 ? 0 : static_cast<double>(this->total) / static_cast<double>(this->count);
+    }
+
+    void add(size_t tokens) {
+      this->min = this->count == 0 ? tokens : std::min(this->min, tokens);
+      this->max = std::max(this->max, tokens);
+      this->total += tokens;
+      ++this->count;
+    }
+
+    void merge(const TokenStats &other) {
+      if (other.count == 0) {
+        return;
+      }
+      this->min = this->count == 0 ? other.min : std::min(this->min, other.min);
+      this->max = std::max(this->max, other.max);
+      this->total += other.total;
+      this->count += other.count;
+    }
+  };
+
+  struct DatasetReport {
+    size_t lines = 0;
+    // lines that are well-formed, within the limits and not duplicates
+    size_t valid = 0;
+    size_t invalid = 0;
+    size_t duplicates = 0;
+    // sorted by line, at most DatasetOptions::max_errors
+    std::vector<DatasetError> errors;
+    // statistics of the well-formed lines
+    TokenStats prompt_tokens;
+    TokenStats completion_tokens;
+    TokenStats example_tokens;
+    // filled by DatasetValidator::split
+    size_t train_examples = 0;
+    size_t validation_examples = 0;
+
+    bool ok() const { return this->invalid == 0 && this->duplicates == 0; }
+  };
+
+  // Validates JSONL fine-tuning datasets before they are uploaded:
+  //  every line must be a JSON object with "prompt" and "completion" strings,
+  //  stay under the token limit and not repeat an earlier example.
+  // The file is memory mapped and split on line boundaries between threads.
+  //
+  // Eg:
+  //  openai::DatasetValidator validator;
+  //  auto report = validator.split("data.jsonl", "train.jsonl", "valid.jsonl", 0.1);
+  //  for (const auto &error : report.errors) {
+  //    std::cerr << "line " << error.line << ": " << error.message << std::endl;
+  //  }
+  class DatasetValidator {
+   private:
+    DatasetOptions options;
+
+    // A well-formed example, its views point into the dataset
+    struct Example {
+      uint64_t hash;
+      size_t line;
+      std::string_view prompt;
+      std::string_view completion;
+    };
+
+    // Results of one thread, line numbers are relative to its range
+    struct Partial {
+      size_t lines = 0;
+      size_t invalid = 0;
+      std::vector<DatasetError> errors;
+      // lines to leave out of the split
+      std::vector<size_t> rejected;
+      std::vector<Example> examples;
+      TokenStats prompt_tokens;
+      TokenStats completion_tokens;
+      TokenStats example_tokens;
+    };
+
+   public:
+    explicit DatasetValidator(DatasetOptions options = {}) : options(std::move(options)) {}
+
+    DatasetReport validate(const std::string &path) const {
+      http::FileReader file(path);
+      std::string fallback;
+      std::vector<size_t> rejected;
+      return this->run(DatasetValidator::map(file, fallback), rejected);
+    }
+
+    // Validate `path`, then write its valid examples to `train_path` and `validation_path`.
+    // An example goes to the validation file with a probability of `validation_ratio`,
+    //  based on a hash of its content so the split is the same on every run.
+    DatasetReport split(const std::string &path,
+                        const std::string &train_path,
+                        const std::string &validation_path,
+                        const double validation_ratio = 0.1) const {
+      http::FileReader file(path);
+      std::string fallback;
+      const auto data = DatasetValidator::map(file, fallback);
+      std::vector<size_t> rejected;
+      auto report = this->run(data, rejected);
+
+      std::ofstream train(train_path, std::ios::binary | std::ios::trunc);
+      std::ofstream validation(validation_path, std::ios::binary | std::ios::trunc);
+      if (!train || !validation) {
+        throw std::runtime_error("cannot write to: " + (!train ? train_path : validation_path));
+      }
+
+      const auto threshold = static_cast<uint64_t>(std::clamp(validation_ratio, 0.0, 1.0) * 1000000);
+      auto next_rejected = rejected.begin();
+      size_t line_number = 0;
+      DatasetValidator::for_each_line(data, [&](std::string_view line) {
+        while (next_rejected != rejected.end() && *next_rejected < line_number) {
+          ++next_rejected;
+        }
+        if (next_rejected == rejected.end() || *next_rejected != line_number) {
+          const bool to_validation = DatasetValidator::hash(line, 0) % 1000000 < threshold;
+          auto &out = to_validation ? validation : train;
+          out.write(line.data(), static_cast<std::streamsize>(line.size()));
+          out.put('\n');
+          ++(to_validation ? report.validation_examples : report.train_examples);
+        }
+        ++line_number;
+      });
+
+      train.flush();
+      validation.flush();
+      if (!train || !validation) {
+        throw std::runtime_error("cannot write to: " + (!train ? train_path : validation_path));
+      }
+      return report;
+    }
+
+   private:
+    // Validate `data`, `rejected` receives the sorted numbers (0-based) of the lines to leave out
+    DatasetReport run(std::string_view data, std::vector<size_t> &rejected) const {
+      // split on line boundaries
+      auto threads = this->options.threads != 0 ? this->options.threads : std::thread::hardware_concurrency();
+      threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(data.size() / (1024 * 1024) + 1)));
+      std::vector<size_t> bounds = {0};
+      for (unsigned i = 1; i < threads; ++i) {
+        auto pos = std::max(bounds.back(), data.size() * i / threads);
+        if (pos > 0 && pos < data.size() && data[pos - 1] != '\n') {
+          const auto newline = data.find('\n', pos);
+          pos = newline == std::string_view::npos ? data.size() : newline + 1;
+        }
+        bounds.push_back(pos);
+      }
+      bounds.push_back(data.size());
+
+      std::vector<Partial> partials(threads);
+      std::vector<std::thread> workers;
+      for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i] {
+          this->validate_range(data.substr(bounds[i], bounds[i + 1] - bounds[i]), partials[i]);
+        });
+      }
+      for (auto &worker : workers) {
+        worker.join();
+      }
+
+      // merge, moving line numbers to the whole file
+      DatasetReport report;
+      std::vector<Example> examples;
+      for (auto &partial : partials) {
+        const auto offset = report.lines;
+        for (auto &error : partial.errors) {
+          error.line += offset;
+          report.errors.push_back(std::move(error));
+        }
+        for (const auto line : partial.rejected) {
+          rejected.push_back(line + offset);
+        }
+        for (auto example : partial.examples) {
+          example.line += offset;
+          examples.push_back(example);
+        }
+        report.lines += partial.lines;
+        report.invalid += partial.invalid;
+        report.prompt_tokens.merge(partial.prompt_tokens);
+        report.completion_tokens.merge(partial.completion_tokens);
+        report.example_tokens.merge(partial.example_tokens);
+      }
+
+      if (this->options.reject_duplicates) {
+        // sorted by hash then line. In a run of equal hashes, an example is a duplicate of the first line
+        //  of the run with the same prompt and completion: different examples can share a hash
+        std::sort(examples.begin(), examples.end(), [](const auto &a, const auto &b) {
+          return a.hash != b.hash ? a.hash < b.hash : a.line < b.line;
+        });
+        size_t first = 0;
+        for (size_t i = 1; i < examples.size(); ++i) {
+          if (examples[i].hash != examples[first].hash) {
+            first = i;
+            continue;
+          }
+          for (size_t j = first; j < i; ++j) {
+            if (examples[j].prompt == examples[i].prompt && examples[j].completion == examples[i].completion) {
+              ++report.duplicates;
+              rejected.push_back(examples[i].line);
+              report.errors.push_back({examples[i].line + 1,
+                                       "duplicate of line " + std::to_string(examples[j].line + 1)});
+              break;
+            }
+          }
+        }
+      }
+      std::sort(rejected.begin(), rejected.end());
+
+      std::sort(report.errors.begin(), report.errors.end(), [](const auto &a, const auto &b) {
+        return a.line < b.line;
+      });
+      if (report.errors.size() > this->options.max_errors) {
+        report.errors.resize(this->options.max_errors);
+      }
+      report.valid = report.lines - report.invalid - report.duplicates;
+      return report;
+    }
+
+    void validate_range(std::string_view data, Partial &partial) const {
+      DatasetValidator::for_each_line(data, [&](std::string_view line) {
+        const auto line_number = partial.lines++;
+
+        std::string_view prompt;
+        std::string_view completion;
+        auto error = DatasetValidator::parse_line(line, prompt, completion);
+        if (error.empty()) {
+          const auto prompt_tokens = estimate_tokens(prompt);
+          const auto completion_tokens = estimate_tokens(completion);
+          partial.prompt_tokens.add(prompt_tokens);
+          partial.completion_tokens.add(completion_tokens);
+          partial.example_tokens.add(prompt_tokens + completion_tokens);
+
+          if (prompt_tokens + completion_tokens > this->options.max_tokens) {
+            error = "too many tokens: ~" + std::to_string(prompt_tokens + completion_tokens)
+                + " > " + std::to_string(this->options.max_tokens);
+          } else if (this->options.reject_duplicates) {
+            partial.examples.push_back({DatasetValidator::hash(completion, DatasetValidator::hash(prompt, 0)),
+                                        line_number, prompt, completion});
+          }
+        }
+
+        if (!error.empty()) {
+          ++partial.invalid;
+          partial.rejected.push_back(line_number);
+          if (partial.errors.size() < this->options.max_errors) {
+            partial.errors.push_back({line_number + 1, std::move(error)});
+          }
+        }
+      });
+    }
+
+    // Calls `callback` with every line of `data`, without the line terminator
+    template<typename Callback>
+    static void for_each_line(std::string_view data, Callback &&callback) {
+      size_t pos = 0;
+      while (pos < data.size()) {
+        auto end = data.find('\n', pos);
+        const auto next = end == std::string_view::npos ? data.size() : end + 1;
+        end = std::min(end, data.size());
+        if (end > pos && data[end - 1] == '\r') {
+          --end;
+        }
+        callback(data.substr(pos, end - pos));
+        pos = next;
+      }
+    }
+
+    static std::string_view map(http::FileReader &file, std::string &fallback) {
+      if (file.data()) {
+        return {file.data(), static_cast<size_t>(file.size())};
+      }
+      fallback.resize(static_cast<size_t>(file.size()));
+      if (file.read_at(0, fallback.data(), fallback.size()) != fallback.size()) {
+        throw std::runtime_error("cannot read the dataset");
+      }
+      return fallback;
+    }
+
+    static uint64_t mix(uint64_t value) {
+      value ^= value >> 33;
+      value *= 0xff51afd7ed558ccdULL;
+      value ^= value >> 33;
+      value *= 0xc4ceb9fe1a85ec53ULL;
+      value ^= value >> 33;
+      return value;
+    }
+
+    static uint64_t hash(std::string_view data, uint64_t seed) {
+      auto h = seed ^ (data.size() * 0x9e3779b97f4a7c15ULL);
+      size_t i = 0;
+      for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        h = (h ^ DatasetValidator::mix(word)) * 0x9e3779b97f4a7c15ULL;
+      }
+      uint64_t tail = 0;
+      std::memcpy(&tail, data.data() + i, data.size() - i);
+      return DatasetValidator::mix(h ^ tail);
+    }
+
+    // Minimal JSON scanner, only validates the syntax and extracts the raw (still escaped)
+    //  "prompt" and "completion" strings. Returns an error message, empty when the line is valid.
+    class LineScanner {
+     private:
+      std::string_view line;
+      size_t pos = 0;
+
+     public:
+      explicit LineScanner(std::string_view line) : line(line) {}
+
+      std::string scan(std::string_view &prompt, std::string_view &completion) {
+        bool has_prompt = false;
+        bool has_completion = false;
+
+        this->skip_whitespace();
+        if (this->pos == this->line.size()) {
+          return "empty line";
+        }
+        if (!this->consume('{')) {
+          return this->error("expected a JSON object");
+        }
+        this->skip_whitespace();
+        if (!this->consume('}')) {
+          while (true) {
+            std::string_view key;
+            std::string_view value;
+            this->skip_whitespace();
+            if (!this->string(key)) {
+              return this->error("expected a string key");
+            }
+            this->skip_whitespace();
+            if (!this->consume(':')) {
+              return this->error("expected ':'");
+            }
+            this->skip_whitespace();
+
+            const bool is_prompt = key == "prompt";
+            const bool is_completion = key == "completion";
+            if (is_prompt || is_completion) {
+              const bool quoted = this->pos < this->line.size() && this->line[this->pos] == '"';
+              if (!this->string(value)) {
+                return this->error(quoted ? "invalid string" : std::string(key) + " must be a string");
+              }
+              (is_prompt ? prompt : completion) = value;
+              (is_prompt ? has_prompt : has_completion) = true;
+            } else if (!this->value(0)) {
+              return this->error("invalid value");
+            }
+
+            this->skip_whitespace();
+            if (this->consume('}')) {
+              break;
+            }
+            if (!this->consume(',')) {
+              return this->error("expected ',' or '}'");
+            }
+          }
+        }
+
+        this->skip_whitespace();
+        if (this->pos != this->line.size()) {
+          return this->error("unexpected data after the object");
+        }
+        if (!has_prompt) {
+          return "missing \"prompt\"";
+        }
+        if (!has_completion) {
+          return "missing \"completion\"";
+        }
+        return {};
+      }
+
+     private:
+      std::string error(const std::string &message) const {
+        return message + " at column " + std::to_string(this->pos + 1);
+      }
+
+      void skip_whitespace() {
+        while (this->pos < this->line.size()) {
+          const auto c = this->line[this->pos];
+          if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            break;
+          }
+          ++this->pos;
+        }
+      }
+
+      bool consume(char expected) {
+        if (this->pos < this->line.size() && this->line[this->pos] == expected) {
+          ++this->pos;
+          return true;
+        }
+        return false;
+      }
+
+      bool string(std::string_view &out) {
+        if (!this->consume('"')) {
+          return false;
+        }
+        const auto start = this->pos;
+        while (this->pos < this->line.size()) {
+          const auto c = static_cast<unsigned char>(this->line[this->pos]);
+          if (c == '"') {
+            out = this->line.substr(start, this->pos - start);
+            ++this->pos;
+            return true;
+          }
+          if (c < 0x20) {
+            return false;
+          }
+          if (c == '\\') {
+            if (++this->pos == this->line.size()) {
+              return false;
+            }
+            const auto escaped = this->line[this->pos];
+            if (escaped == 'u') {
+              for (int i = 0; i < 4; ++i) {
+                if (++this->pos == this->line.size() || !std::isxdigit(static_cast<unsigned char>(this->line[this->pos]))) {
+                  return false;
+                }
+              }
+            } else if (std::strchr("\"\\/bfnrt", escaped) == nullptr || escaped == '\0') {
+              return false;
+            }
+          }
+          ++this->pos;
+        }
+        return false;
+      }
+
+      bool literal(std::string_view expected) {
+        if (this->line.substr(this->pos, expected.size()) != expected) {
+          return false;
+        }
+        this->pos += expected.size();
+        return true;
+      }
+
+      bool number() {
+        const auto start = this->pos;
+        this->consume('-');
+        while (this->pos < this->line.size() && std::strchr("0123456789.eE+-", this->line[this->pos]) != nullptr
+            && this->line[this->pos] != '\0') {
+          ++this->pos;
+        }
+        return this->pos > start && std::isdigit(static_cast<unsigned char>(this->line[this->pos - 1]));
+      }
+
+      bool value(int depth) {
+        if (depth > 64 || this->pos == this->line.size()) {
+          return false;
+        }
+        std::string_view ignored;
+        switch (this->line[this->pos]) {
+          case '"':
+            return this->string(ignored);
+          case 't':
+            return this->literal("true");
+          case 'f':
+            return this->literal("false");
+          case 'n':
+            return this->literal("null");
+          case '[':
+          case '{': {
+            const bool object = this->line[this->pos++] == '{';
+            const char close = object ? '}' : ']';
+            this->skip_whitespace();
+            if (this->consume(close)) {
+              return true;
+            }
+            while (true) {
+              this->skip_whitespace();
+              if (object) {
+                if (!this->string(ignored)) {
+                  return false;
+                }
+                this->skip_whitespace();
+                if (!this->consume(':')) {
+                  return false;
+                }
+                this->skip_whitespace();
+              }
+              if (!this->value(depth + 1)) {
+                return false;
+              }
+              this->skip_whitespace();
+              if (this->consume(close)) {
+                return true;
+              }
+              if (!this->consume(',')) {
+                return false;
+              }
+            }
+          }
+          default:
+            return this->number();
+        }
+      }
+    };
+
+    static std::string parse_line(std::string_view line, std::string_view &prompt, std::string_view &completion) {
+      return LineScanner(line).scan(prompt, completion);
+    }
+  };
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <daw/json/daw_json_link.h>
+#include "../lib/httplib.hpp"
+#include "openai/http/circuit_breaker.hpp"
+#include "openai/http/request_options.hpp"
+#include "openai/models/errors.hpp"
+
+namespace openai {
+  enum ERROR_KIND {
+    // the call did not complete: connection, read or write failure
+    error_transport,
+    // the API answered with a non-200 status
+    error_http_status,
+    // the response body could not be parsed
+    error_parse,
+    // the call was rejected by an open circuit breaker, see http::CircuitBreaker
+    error_circuit_open,
+    // see http::RequestOptions
+    error_cancelled,
+    error_deadline_exceeded,
+    // the call was not sent: its input breaks a documented requirement of the endpoint
+    error_invalid_input,
+    // a local file could not be read or written
+    error_io,
+  };
+
+  // Why a call failed.
+  // Cheap to build: the response body is moved in, and the message is only formatted by `to_string`.
+  class Error {
+   public:
+    ERROR_KIND kind = error_transport;
+    // HTTP status, 0 when there was no response
+    int status = 0;
+    httplib::Error transport_error = httplib::Error::Success;
+    // request path, the endpoint for error_circuit_open, or the local file for error_io
+    std::string path;
+    // response body
+    std::string body;
+    // JSON body of the request, when there was one
+    std::shared_ptr<const std::string> query_body;
+    // parse error message, the domain for error_circuit_open, or what is wrong for error_invalid_input and error_io
+    std::string detail;
+
+   private:
+    mutable std::optional<std::optional<models::APIErrorDetails>> parsed_details;
+
+   public:
+    // Whether sending the same call again later can succeed
+    bool retryable() const {
+      switch (this->kind) {
+        case error_transport:
+          return this->transport_error == httplib::Error::Connection ||
+              this->transport_error == httplib::Error::ConnectionTimeout ||
+              this->transport_error == httplib::Error::Read ||
+              this->transport_error == httplib::Error::Write;
+        case error_http_status:
+          if (this->status == 429) {
+            // rate limited: retry, out of credits: do not
+            return this->body.find("insufficient_quota") == std::string::npos;
+          }
+          return this->status == 408 || this->status == 500 || this->status == 502 ||
+              this->status == 503 || this->status == 504;
+        case error_circuit_open:
+          return true;
+        case error_parse:
+        case error_cancelled:
+        case error_deadline_exceeded:
+        case error_invalid_input:
+        case error_io:
+          return false;
+      }
+      return false;
+    }
+
+    // The error returned by the API (type, code, message), parsed on first access.
+    // Empty when the body is not an API error.
+    const std::optional<models::APIErrorDetails> &details() const {
+      if (!this->parsed_details) {
+        this->parsed_details.emplace();
+        if (this->kind == error_http_status && !this->body.empty()) {
+          try {
+            this->parsed_details->emplace(daw::json::from_json<models::APIErrorResponse>(this->body).error);
+          } catch (...) {
+          }
+        }
+      }
+      return *this->parsed_details;
+    }
+
+    // Human readable description of the error
+    std::string to_string() const {
+      switch (this->kind) {
+        case error_transport:
+          return httplib::to_string(this->transport_error);
+        case error_http_status:
+          if (this->query_body) {
+            return "Response status not success: " + std::to_string(this->status) +
+                "\nurl is: " + this->path +
+                "\nQuery body:\n" + *this->query_body +
+                "\nResponse body:\n" + this->body;
+          }
+          return "Response status not success: " + std::to_string(this->status) +
+              "\nurl is: " + this->path +
+              "\nResponse body is:\n" + this->body;
+        case error_parse:
+          return "exception: " + this->detail +
+              "\nurl is: " + this->path +
+              "\nResponse body is:\n" + this->body;
+        case error_circuit_open:
+          return http::CircuitOpenError(this->path, this->detail).what();
+        case error_cancelled:
+          return http::CancelledError().what();
+        case error_deadline_exceeded:
+          return http::DeadlineExceededError().what();
+        case error_invalid_input:
+          return "invalid input: " + this->detail +
+              "\nurl is: " + this->path;
+        case error_io:
+          return this->detail + ": " + this->path;
+      }
+      return "unknown error";
+    }
+  };
+
+  // Exception thrown by the throwing API. `what()` is formatted on first call.
+  class ApiError : public std::runtime_error {
+   private:
+    Error error;
+    mutable std::string message;
+
+   public:
+    explicit ApiError(Error error) : std::runtime_error(""), error(std::move(error)) {}
+
+    const Error &get_error() const noexcept { return this->error; }
+
+    const char *what() const noexcept override {
+      if (this->message.empty()) {
+        try {
+          this->message = this->error.to_string();
+        } catch (...) {
+          return "openai::ApiError";
+        }
+      }
+      return this->message.c_str();
+    }
+  };
+
+  // Throw the exception matching the error kind
+  [[noreturn]] inline void throw_error(Error error) {
+    switch (error.kind) {
+      case error_circuit_open:
+        throw http::CircuitOpenError(error.path, error.detail);
+      case error_cancelled:
+        throw http::CancelledError();
+      case error_deadline_exceeded:
+        throw http::DeadlineExceededError();
+      default:
+        throw ApiError(std::move(error));
+    }
+  }
+
+  // Either the result of a call, or why it failed. Similar to C++23 std::expected<T, Error>.
+  template<typename T>
+  class Expected {
+   private:
+    std::variant<T, Error> storage;
+
+   public:
+    Expected(T value) : storage(std::in_place_index<0>, std::move(value)) {}
+    Expected(Error error) : storage(std::in_place_index<1>, std::move(error)) {}
+
+    bool has_value() const noexcept { return this->storage.index() == 0; }
+    explicit operator bool() const noexcept { return this->has_value(); }
+
+    // The result, throws the error if there is none
+    T &value() & {
+      if (!this->has_value()) {
+        throw_error(std::get<1>(this->storage));
+      }
+      return std::get<0>(this->storage);
+    }
+
+    T &&value() && {
+      if (!this->has_value()) {
+        throw_error(std::move(std::get<1>(this->storage)));
+      }
+      return std::move(std::get<0>(this->storage));
+    }
+
+    template<typename U>
+    T value_or(U &&default_value) && {
+      if (!this->has_value()) {
+        return static_cast<T>(std::forward<U>(default_value));
+      }
+      return std::move(std::get<0>(this->storage));
+    }
+
+    const Error &error() const & { return std::get<1>(this->storage); }
+    Error &&error() && { return std::move(std::get<1>(this->storage)); }
+
+    T &operator*() & { return std::get<0>(this->storage); }
+    T *operator->() { return &std::get<0>(this->storage); }
+  };
+}
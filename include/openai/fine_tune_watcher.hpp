@@ -0,0 +1,451 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "openai/api_utils.hpp"
+#include "openai/models/fine_tune.hpp"
+
+namespace openai {
+  struct FineTuneWatchPolicy {
+    // Poll interval of a running job right after it logged a new event
+    std::chrono::milliseconds min_interval{2000};
+    // The interval grows by `backoff` after every poll without new events, up to `max_interval`
+    std::chrono::milliseconds max_interval{60000};
+    double backoff = 1.5;
+    // Poll interval of a job waiting in the queue
+    std::chrono::milliseconds pending_interval{30000};
+    // Follow the jobs with the server-sent events stream instead of polling:
+    //  a quiet job costs no request, but holds a connection and a thread.
+    bool stream = false;
+  };
+
+  struct FineTuneWatchHandlers {
+    // Called once for every new event of the job, in order
+    std::function<void(const std::string &fine_tune_id, const models::FineTuneEvent &event)> on_event;
+    // Called when the status of the job changes.
+    // With FineTuneWatchPolicy::stream, only called once the job is over
+    std::function<void(const std::string &fine_tune_id, const std::string &status)> on_status;
+    // Called when the job cannot be watched anymore (eg: unknown job). Retryable errors are retried
+    std::function<void(const std::string &fine_tune_id, const Error &error)> on_error;
+  };
+
+  // Follows many fine-tune jobs and reports their new events.
+  // Jobs are polled from one background thread, at an interval adapted to their status and activity,
+  //  and a job is dropped once it is over (succeeded, failed or cancelled).
+  // Handlers run on the background threads; the API it was created from must outlive the watcher.
+  //
+  // Eg:
+  //  auto watcher = api.new_fine_tune_watcher();
+  //  watcher->watch("ft-123", {
+  //    [](const std::string &id, const openai::models::FineTuneEvent &event) { std::cout << event.message << std::endl; },
+  //    [](const std::string &id, const std::string &status) { std::cout << id << ": " << status << std::endl; },
+  //  });
+  class FineTuneWatcher {
+   private:
+    struct Job {
+      std::string id;
+      // replaced by `watch` under the lock, see `handlers_of`
+      std::shared_ptr<const FineTuneWatchHandlers> handlers;
+      std::string status;
+      // newest event delivered, and the messages delivered with that timestamp
+      int64_t last_created_at = -1;
+      std::set<std::string> last_messages;
+      // the last response, to skip parsing when nothing changed
+      uint64_t last_body_hash = 0;
+      std::chrono::milliseconds interval{0};
+      std::chrono::steady_clock::time_point next_poll;
+      // stream mode
+      std::shared_ptr<http::CancellationToken> cancellation = http::CancellationToken::create();
+      std::thread stream_thread;
+    };
+
+    http::HttpClient *http_client;
+    const FineTuneWatchPolicy policy;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::map<std::string, std::shared_ptr<Job>> jobs;
+    // threads of the streams that are over, joined later
+    std::vector<std::thread> finished;
+    bool stopping = false;
+    std::shared_ptr<http::CancellationToken> cancellation = http::CancellationToken::create();
+    std::thread poller;
+
+   public:
+    explicit FineTuneWatcher(http::HttpClient *http_client, FineTuneWatchPolicy policy = {})
+        : http_client(http_client), policy(std::move(policy)) {}
+
+    FineTuneWatcher(const FineTuneWatcher &) = delete;
+    FineTuneWatcher &operator=(const FineTuneWatcher &) = delete;
+
+    ~FineTuneWatcher() {
+      this->stop();
+    }
+
+    // Start following a job. Watching a job already followed replaces its handlers
+    void watch(const std::string &fine_tune_id, FineTuneWatchHandlers handlers) {
+      std::vector<std::thread> to_join;
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->stopping) {
+          return;
+        }
+
+        auto found = this->jobs.find(fine_tune_id);
+        if (found != this->jobs.end()) {
+          found->second->handlers = std::make_shared<const FineTuneWatchHandlers>(std::move(handlers));
+          return;
+        }
+
+        auto job = std::make_shared<Job>();
+        job->id = fine_tune_id;
+        job->handlers = std::make_shared<const FineTuneWatchHandlers>(std::move(handlers));
+        job->interval = this->policy.min_interval;
+        job->next_poll = std::chrono::steady_clock::now();
+        this->jobs.emplace(fine_tune_id, job);
+
+        if (this->policy.stream) {
+          job->stream_thread = std::thread([this, job]() { this->follow_stream(job); });
+          this->take_finished(to_join);
+        } else if (!this->poller.joinable()) {
+          this->poller = std::thread([this]() { this->poll_loop(); });
+        }
+      }
+      this->wakeup.notify_all();
+      for (auto &thread : to_join) {
+        thread.join();
+      }
+    }
+
+    // Stop following a job. Can be called from a handler
+    void unwatch(const std::string &fine_tune_id) {
+      std::shared_ptr<Job> job;
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto found = this->jobs.find(fine_tune_id);
+        if (found == this->jobs.end()) {
+          return;
+        }
+        job = found->second;
+        this->jobs.erase(found);
+      }
+      job->cancellation->cancel();
+      this->wakeup.notify_all();
+      this->release_stream_thread(job);
+    }
+
+    // Number of jobs followed
+    size_t size() {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      return this->jobs.size();
+    }
+
+    // Stop following every job and wait for the background threads
+    void stop() {
+      std::map<std::string, std::shared_ptr<Job>> stopped;
+      std::vector<std::thread> to_join;
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+        stopped.swap(this->jobs);
+        to_join.swap(this->finished);
+      }
+      this->wakeup.notify_all();
+      this->cancellation->cancel();
+
+      for (auto &entry : stopped) {
+        entry.second->cancellation->cancel();
+      }
+      for (auto &entry : stopped) {
+        this->release_stream_thread(entry.second);
+      }
+      for (auto &thread : to_join) {
+        if (thread.get_id() != std::this_thread::get_id()) {
+          thread.join();
+        } else {
+          thread.detach();
+        }
+      }
+      if (this->poller.joinable()) {
+        if (this->poller.get_id() != std::this_thread::get_id()) {
+          this->poller.join();
+        } else {
+          this->poller.detach();
+        }
+      }
+    }
+
+   private:
+    static bool is_over(const std::string &status) {
+      return status == "succeeded" || status == "failed" || status == "cancelled";
+    }
+
+    // Join the stream thread of a job, or keep it for later when called from that thread
+    void release_stream_thread(const std::shared_ptr<Job> &job) {
+      if (!job->stream_thread.joinable()) {
+        return;
+      }
+      if (job->stream_thread.get_id() == std::this_thread::get_id()) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->stopping) {
+          job->stream_thread.detach();
+        } else {
+          this->finished.push_back(std::move(job->stream_thread));
+        }
+        return;
+      }
+      job->stream_thread.join();
+    }
+
+    // Must be called with the lock held
+    void take_finished(std::vector<std::thread> &to_join) {
+      for (auto it = this->finished.begin(); it != this->finished.end();) {
+        if (it->get_id() != std::this_thread::get_id()) {
+          to_join.push_back(std::move(*it));
+          it = this->finished.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    http::RequestOptions request_options(const std::shared_ptr<http::CancellationToken> &token) const {
+      http::RequestOptions options;
+      options.cancellation = token;
+      return options;
+    }
+
+    // Deduplicate events by (created_at, message). Events are listed oldest first
+    static bool is_new(Job &job, const models::FineTuneEvent &event) {
+      if (event.created_at < job.last_created_at) {
+        return false;
+      }
+      if (event.created_at > job.last_created_at) {
+        job.last_created_at = event.created_at;
+        job.last_messages.clear();
+      }
+      return job.last_messages.insert(event.message).second;
+    }
+
+    static uint64_t hash(std::string_view data) {
+      // FNV-1a
+      uint64_t h = 0xcbf29ce484222325ULL;
+      for (const auto c : data) {
+        h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+      }
+      return h;
+    }
+
+    // The current handlers of a job, called without the lock while `watch` may replace them
+    std::shared_ptr<const FineTuneWatchHandlers> handlers_of(const Job &job) {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      return job.handlers;
+    }
+
+    void report_status(Job &job, const std::string &status) {
+      if (status != job.status) {
+        job.status = status;
+        const auto handlers = this->handlers_of(job);
+        if (handlers->on_status) {
+          handlers->on_status(job.id, status);
+        }
+      }
+    }
+
+    // Poll mode
+
+    void poll_loop() {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      while (!this->stopping) {
+        if (this->jobs.empty()) {
+          this->wakeup.wait(lock);
+          continue;
+        }
+
+        auto next = std::min_element(this->jobs.begin(), this->jobs.end(), [](const auto &a, const auto &b) {
+          return a.second->next_poll < b.second->next_poll;
+        })->second;
+        if (next->next_poll > std::chrono::steady_clock::now()) {
+          // woken up early by watch/unwatch/stop: pick the next job again
+          this->wakeup.wait_until(lock, next->next_poll);
+          continue;
+        }
+
+        lock.unlock();
+        const bool keep = this->poll(*next);
+        lock.lock();
+
+        auto found = this->jobs.find(next->id);
+        if (found == this->jobs.end() || found->second != next) {
+          continue;
+        }
+        if (keep) {
+          next->next_poll = std::chrono::steady_clock::now() + next->interval;
+        } else {
+          this->jobs.erase(found);
+        }
+      }
+    }
+
+    // Returns false once the job does not need to be polled anymore
+    bool poll(Job &job) {
+      const auto path = "/v1/fine-tunes/" + job.id;
+      auto body = this->http_client->try_get<std::string>(path, this->request_options(this->cancellation));
+      const auto slower = std::min(
+          std::chrono::duration_cast<std::chrono::milliseconds>(job.interval * this->policy.backoff),
+          this->policy.max_interval);
+
+      if (!body) {
+        if (body.error().kind == error_cancelled) {
+          return false;
+        }
+        if (body.error().retryable()) {
+          job.interval = slower;
+          return true;
+        }
+        const auto handlers = this->handlers_of(job);
+        if (handlers->on_error) {
+          handlers->on_error(job.id, body.error());
+        }
+        return false;
+      }
+
+      // the job did not change since the last poll
+      const auto body_hash = FineTuneWatcher::hash(body.value());
+      if (body_hash == job.last_body_hash) {
+        job.interval = slower;
+        return true;
+      }
+      job.last_body_hash = body_hash;
+
+      models::FineTune fine_tune;
+      try {
+        fine_tune = this->http_client->parse_response_content<models::FineTune>(body.value());
+      } catch (const std::exception &exc) {
+        Error error;
+        error.kind = error_parse;
+        error.path = path;
+        error.detail = exc.what();
+        error.body = std::move(body).value();
+        const auto handlers = this->handlers_of(job);
+        if (handlers->on_error) {
+          handlers->on_error(job.id, error);
+        }
+        return false;
+      }
+
+      bool has_new_events = false;
+      if (fine_tune.events) {
+        const auto handlers = this->handlers_of(job);
+        for (const auto &event : *fine_tune.events) {
+          if (FineTuneWatcher::is_new(job, event)) {
+            has_new_events = true;
+            if (handlers->on_event) {
+              handlers->on_event(job.id, event);
+            }
+          }
+        }
+      }
+      this->report_status(job, fine_tune.status);
+
+      if (FineTuneWatcher::is_over(fine_tune.status)) {
+        return false;
+      }
+      if (fine_tune.status == "pending") {
+        job.interval = this->policy.pending_interval;
+      } else {
+        job.interval = has_new_events ? this->policy.min_interval : slower;
+      }
+      return true;
+    }
+
+    // Stream mode
+
+    void follow_stream(const std::shared_ptr<Job> &job) {
+      const auto path = "/v1/fine-tunes/" + job->id + "/events?stream=true";
+      auto retry_delay = this->policy.min_interval;
+
+      while (!job->cancellation->is_cancelled()) {
+        std::string buffer;
+        bool done = false;
+
+        // server-sent events: "data: {event}\n\n", then "data: [DONE]"
+        auto status = this->http_client->try_get_stream(path, {}, nullptr, [&](const char *data, size_t length) {
+          buffer.append(data, length);
+          size_t start = 0;
+          for (auto end = buffer.find('\n'); end != std::string::npos; end = buffer.find('\n', start)) {
+            std::string_view line(buffer.data() + start, end - start);
+            start = end + 1;
+            if (line.substr(0, 5) != "data:") {
+              continue;
+            }
+            line.remove_prefix(line.size() > 5 && line[5] == ' ' ? 6 : 5);
+            if (line == "[DONE]") {
+              done = true;
+              continue;
+            }
+            try {
+              auto event = this->http_client->parse_response_content<models::FineTuneEvent>(std::string(line));
+              if (FineTuneWatcher::is_new(*job, event)) {
+                const auto handlers = this->handlers_of(*job);
+                if (handlers->on_event) {
+                  handlers->on_event(job->id, event);
+                }
+              }
+            } catch (const std::exception &) {
+              // not an event
+            }
+          }
+          buffer.erase(0, start);
+          return true;
+        }, nullptr, this->request_options(job->cancellation));
+
+        if (done || (status && !job->cancellation->is_cancelled())) {
+          // the stream ends with the job
+          auto fine_tune = this->http_client->try_get<models::FineTune>("/v1/fine-tunes/" + job->id,
+                                                                        this->request_options(job->cancellation));
+          if (fine_tune && FineTuneWatcher::is_over(fine_tune->status)) {
+            this->report_status(*job, fine_tune->status);
+            break;
+          }
+        } else if (!status) {
+          if (status.error().kind == error_cancelled) {
+            break;
+          }
+          if (!status.error().retryable()) {
+            const auto handlers = this->handlers_of(*job);
+            if (handlers->on_error) {
+              handlers->on_error(job->id, status.error());
+            }
+            break;
+          }
+        }
+
+        // reconnect: the stream replays the past events, deduplicated by is_new
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->wakeup.wait_for(lock, retry_delay, [&]() { return this->stopping || job->cancellation->is_cancelled(); });
+        retry_delay = std::min(std::chrono::duration_cast<std::chrono::milliseconds>(retry_delay * this->policy.backoff),
+                               this->policy.max_interval);
+      }
+
+      // the job is over: stop tracking it, the thread is joined later
+      std::lock_guard<std::mutex> lock(this->mutex);
+      auto found = this->jobs.find(job->id);
+      if (found != this->jobs.end() && found->second == job) {
+        this->finished.push_back(std::move(job->stream_thread));
+        this->jobs.erase(found);
+      }
+    }
+  };
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+
+namespace openai {
+  namespace http {
+    // The buffer request bodies of this thread are serialized into, borrowed for one call.
+    // It keeps its capacity from one call to the next: once it has grown to the usual body size,
+    //  serializing a request allocates nothing.
+    // A second borrower on the same thread gets a buffer of its own.
+    class BodyBuffer {
+     private:
+      // a larger buffer is released after the call instead of being kept by the thread
+      static constexpr size_t max_retained_capacity = 1 << 20;
+
+      struct Slot {
+        std::string data;
+        bool borrowed = false;
+      };
+
+      Slot *slot = nullptr;
+      std::string own;
+
+      static Slot &thread_slot() {
+        thread_local Slot slot;
+        return slot;
+      }
+
+     public:
+      BodyBuffer() {
+        auto &slot = BodyBuffer::thread_slot();
+        if (!slot.borrowed) {
+          slot.borrowed = true;
+          slot.data.clear();
+          this->slot = &slot;
+        }
+      }
+
+      ~BodyBuffer() {
+        if (!this->slot) {
+          return;
+        }
+        if (this->slot->data.capacity() > max_retained_capacity) {
+          std::string().swap(this->slot->data);
+        }
+        this->slot->borrowed = false;
+      }
+
+      BodyBuffer(const BodyBuffer &) = delete;
+      BodyBuffer &operator=(const BodyBuffer &) = delete;
+
+      // Empty when borrowed
+      std::string &get() {
+        return this->slot ? this->slot->data : this->own;
+      }
+    };
+  }
+}
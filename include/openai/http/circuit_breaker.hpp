@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace openai {
+  namespace http {
+    enum CIRCUIT_STATE {
+      // calls go through
+      circuit_closed,
+      // calls fail fast with CircuitOpenError
+      circuit_open,
+      // a few probe calls go through to test the upstream
+      circuit_half_open,
+    };
+
+    struct CircuitBreakerPolicy {
+      bool enabled = true;
+      // the error rate is measured over this sliding window, with a 1 second resolution (max 60s)
+      std::chrono::seconds window{10};
+      // no decision is taken on less calls than this in the window
+      uint32_t min_calls = 20;
+      // the circuit opens when the error rate over the window is above this ratio
+      double error_rate_threshold = 0.5;
+      // how long the circuit stays open before letting probe calls through
+      std::chrono::milliseconds open_duration{5000};
+      // probe calls allowed at the same time in half-open state
+      uint32_t half_open_probes = 1;
+    };
+
+    // Thrown instead of sending the call when the circuit of the endpoint is open
+    class CircuitOpenError : public std::runtime_error {
+     public:
+      const std::string endpoint;
+      const std::string domain;
+
+      CircuitOpenError(const std::string &endpoint, const std::string &domain)
+          : std::runtime_error("circuit open for " + domain + endpoint + ": upstream is failing, call rejected"),
+            endpoint(endpoint),
+            domain(domain) {}
+    };
+
+    // closed -> open when the error rate over the sliding window crosses the threshold,
+    // open -> half-open after `open_duration`,
+    // half-open -> closed on a successful probe, or back to open on a failed one.
+    class CircuitBreaker {
+     private:
+      struct Bucket {
+        int64_t second = -1;
+        uint32_t calls = 0;
+        uint32_t failures = 0;
+      };
+
+      const CircuitBreakerPolicy &policy;
+
+      std::mutex mutex;
+      std::array<Bucket, 60> buckets{};
+      CIRCUIT_STATE state = circuit_closed;
+      std::chrono::steady_clock::time_point opened_at{};
+      uint32_t probes_in_flight = 0;
+
+     public:
+      explicit CircuitBreaker(const CircuitBreakerPolicy &policy) : policy(policy) {}
+
+      CIRCUIT_STATE get_state() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->state;
+      }
+
+      // Whether a call may be sent now. Every allowed call must be followed by `record` or `release`.
+      bool allow() {
+        if (!this->policy.enabled) {
+          return true;
+        }
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->state == circuit_open) {
+          if (std::chrono::steady_clock::now() - this->opened_at < this->policy.open_duration) {
+            return false;
+          }
+          this->state = circuit_half_open;
+          this->probes_in_flight = 0;
+        }
+        if (this->state == circuit_half_open) {
+          if (this->probes_in_flight >= this->policy.half_open_probes) {
+            return false;
+          }
+          this->probes_in_flight++;
+        }
+        return true;
+      }
+
+      void record(bool failed) {
+        if (!this->policy.enabled) {
+          return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->state == circuit_half_open) {
+          this->probes_in_flight--;
+          if (failed) {
+            this->trip(now);
+          } else {
+            this->state = circuit_closed;
+            this->buckets.fill({});
+          }
+          return;
+        }
+
+        const auto second = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+        auto &bucket = this->buckets[second % this->buckets.size()];
+        if (bucket.second != second) {
+          bucket = {second, 0, 0};
+        }
+        bucket.calls++;
+        bucket.failures += failed ? 1 : 0;
+
+        if (failed && this->state == circuit_closed && this->error_rate_exceeded(second)) {
+          this->trip(now);
+        }
+      }
+
+      // End an allowed call without counting it, when it did not get an answer for a reason
+      //  unrelated to the upstream (cancelled by the caller, deadline exceeded).
+      void release() {
+        if (!this->policy.enabled) {
+          return;
+        }
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->state == circuit_half_open && this->probes_in_flight > 0) {
+          this->probes_in_flight--;
+        }
+      }
+
+     private:
+      bool error_rate_exceeded(int64_t now_second) const {
+        const auto window = std::min<int64_t>(this->policy.window.count(), this->buckets.size());
+        uint32_t calls = 0;
+        uint32_t failures = 0;
+        for (const auto &bucket : this->buckets) {
+          if (bucket.second > now_second - window) {
+            calls += bucket.calls;
+            failures += bucket.failures;
+          }
+        }
+        return calls >= this->policy.min_calls &&
+            static_cast<double>(failures) > this->policy.error_rate_threshold * static_cast<double>(calls);
+      }
+
+      void trip(std::chrono::steady_clock::time_point now) {
+        this->state = circuit_open;
+        this->opened_at = now;
+      }
+    };
+
+    // One circuit breaker per endpoint (see `endpoint_key`)
+    class CircuitBreakers {
+     private:
+      const CircuitBreakerPolicy &policy;
+      std::mutex mutex;
+      std::unordered_map<std::string, std::unique_ptr<CircuitBreaker>> breakers;
+
+     public:
+      explicit CircuitBreakers(const CircuitBreakerPolicy &policy) : policy(policy) {}
+
+      CircuitBreaker &get(const std::string &endpoint) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto &breaker = this->breakers[endpoint];
+        if (!breaker) {
+          breaker = std::make_unique<CircuitBreaker>(this->policy);
+        }
+        return *breaker;
+      }
+    };
+  }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../lib/httplib.hpp"
+
+namespace openai {
+  namespace http {
+    // A pool of keep-alive connections to a single domain.
+    //
+    // httplib::Client holds one socket and cannot serve two requests at the same time,
+    //  so every in-flight request leases its own client and gives it back once done.
+    class ClientPool : public std::enable_shared_from_this<ClientPool> {
+     private:
+      std::string domain;
+      httplib::Headers headers;
+      size_t max_idle;
+
+      std::mutex mutex;
+      std::vector<std::unique_ptr<httplib::Client>> idle;
+
+     public:
+      // RAII handle on a leased client, the client goes back to the pool on destruction
+      class Lease {
+       private:
+        std::shared_ptr<ClientPool> pool;
+        std::unique_ptr<httplib::Client> client;
+
+       public:
+        Lease(std::shared_ptr<ClientPool> pool, std::unique_ptr<httplib::Client> client)
+            : pool(std::move(pool)), client(std::move(client)) {}
+
+        Lease(Lease &&) noexcept = default;
+        Lease &operator=(Lease &&) noexcept = default;
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+
+        ~Lease() {
+          if (this->pool && this->client) {
+            this->pool->release(std::move(this->client));
+          }
+        }
+
+        httplib::Client &operator*() const { return *this->client; }
+        httplib::Client *operator->() const { return this->client.get(); }
+        httplib::Client *get() const { return this->client.get(); }
+        const httplib::Headers &headers() const { return this->pool->headers; }
+      };
+
+      ClientPool(std::string domain, httplib::Headers headers, size_t max_idle = 16)
+          : domain(std::move(domain)), headers(std::move(headers)), max_idle(max_idle) {}
+
+      const std::string &get_domain() const { return this->domain; }
+
+      // Take an idle client, or open a new one if every client is busy
+      Lease acquire() {
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          if (!this->idle.empty()) {
+            auto client = std::move(this->idle.back());
+            this->idle.pop_back();
+            return {this->shared_from_this(), std::move(client)};
+          }
+        }
+        return {this->shared_from_this(), std::make_unique<httplib::Client>(this->domain)};
+      }
+
+     private:
+      void release(std::unique_ptr<httplib::Client> client) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->idle.size() < this->max_idle) {
+          this->idle.push_back(std::move(client));
+        }
+      }
+    };
+  }
+}
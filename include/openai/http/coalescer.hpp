@@ -0,0 +1,196 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include "openai/errors.hpp"
+#include "openai/http/request_options.hpp"
+
+namespace openai {
+  namespace http {
+    // What a caller joining a batch made of it
+    enum COALESCE_JOIN {
+      // the caller is in the batch
+      coalesce_joined,
+      // the caller is in the batch, which is now full and sent right away
+      coalesce_full,
+      // the caller does not fit in the batch: it is sent as it is, and the caller joins a new one
+      coalesce_no_room,
+    };
+
+    // Merges concurrent calls into one.
+    // Callers join the open batch of their key, a batch is sent `window` after it opened or once full,
+    //  from a thread of its own: every caller, the first one included, waits for the result under its own
+    //  cancellation and deadline, and returns early without stopping the call of the others.
+    // The call is sent with the latest deadline of the callers of the batch, none as soon as one has none.
+    //
+    // `Request` is what the callers of a batch add up to, `Result` what the call answers.
+    template<typename Key, typename Request, typename Result>
+    class Coalescer {
+     public:
+      // Sends the batch, called once per batch without any lock held
+      using Send = std::function<Expected<Result>(Request &request, const RequestOptions &options)>;
+
+     private:
+      struct Batch {
+        Key key;
+        Request request;
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        bool unbounded = false;
+        // sent: no one can join anymore
+        bool sealed = false;
+        bool done = false;
+        std::optional<Error> error;
+        Result result;
+      };
+
+      std::string path;
+      std::chrono::microseconds window;
+      Send send;
+
+      std::mutex mutex;
+      // a batch was sealed
+      std::condition_variable sealed;
+      // a batch is done, or a caller was cancelled
+      std::condition_variable changed;
+      std::unordered_map<Key, std::shared_ptr<Batch>> open;
+      // batches being sent, waited for by the destructor
+      size_t in_flight = 0;
+      std::condition_variable idle;
+
+     public:
+      // `path` is the path of the errors of the callers stopped by their options
+      Coalescer(std::string path, std::chrono::microseconds window, Send send)
+          : path(std::move(path)), window(window), send(std::move(send)) {}
+
+      Coalescer(const Coalescer &) = delete;
+      Coalescer &operator=(const Coalescer &) = delete;
+
+      // Waits for the batches in flight: `send` may use its owner
+      ~Coalescer() {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->idle.wait(lock, [this]() { return this->in_flight == 0; });
+      }
+
+      // Add the caller to the open batch of `key` with `join`, called with the lock held
+      //  (with a new Request when no batch is open, where the caller must fit), and wait for the result.
+      Expected<std::shared_ptr<const Result>> submit(const Key &key,
+                                                     const RequestOptions &options,
+                                                     const std::function<COALESCE_JOIN(Request &request)> &join) {
+        // set under the lock: the token runs its callbacks under its own lock,
+        //  so the scope is entered before locking and left after unlocking
+        bool cancelled = false;
+        CancellationScope scope(options, [this, &cancelled]() {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          cancelled = true;
+          this->changed.notify_all();
+        });
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if (cancelled || options.is_expired()) {
+          return this->stopped(cancelled);
+        }
+
+        std::shared_ptr<Batch> batch;
+        auto joined = coalesce_no_room;
+        auto found = this->open.find(key);
+        if (found != this->open.end()) {
+          batch = found->second;
+          joined = join(batch->request);
+          if (joined == coalesce_no_room) {
+            this->seal(batch);
+          }
+        }
+        if (joined == coalesce_no_room) {
+          batch = std::make_shared<Batch>();
+          batch->key = key;
+          joined = join(batch->request);
+          this->open.emplace(key, batch);
+          this->launch(batch);
+        }
+        if (!options.deadline) {
+          batch->unbounded = true;
+        } else if (!batch->deadline || *batch->deadline < *options.deadline) {
+          batch->deadline = options.deadline;
+        }
+        if (joined == coalesce_full) {
+          this->seal(batch);
+        }
+
+        const auto finished = [&]() { return batch->done || cancelled || options.is_expired(); };
+        if (options.deadline) {
+          this->changed.wait_until(lock, *options.deadline, finished);
+        } else {
+          this->changed.wait(lock, finished);
+        }
+        if (!batch->done) {
+          // the batch goes on for the others
+          return this->stopped(cancelled);
+        }
+        if (batch->error) {
+          return *batch->error;
+        }
+        return std::shared_ptr<const Result>(batch, &batch->result);
+      }
+
+     private:
+      Error stopped(bool cancelled) const {
+        Error error;
+        error.kind = cancelled ? error_cancelled : error_deadline_exceeded;
+        error.path = this->path;
+        return error;
+      }
+
+      // called with the lock held
+      void seal(const std::shared_ptr<Batch> &batch) {
+        if (batch->sealed) {
+          return;
+        }
+        batch->sealed = true;
+        auto open_batch = this->open.find(batch->key);
+        if (open_batch != this->open.end() && open_batch->second == batch) {
+          this->open.erase(open_batch);
+        }
+        this->sealed.notify_all();
+      }
+
+      // called with the lock held: send the batch once sealed or after the window
+      void launch(const std::shared_ptr<Batch> &batch) {
+        ++this->in_flight;
+        std::thread([this, batch]() {
+          RequestOptions options;
+          {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->sealed.wait_until(lock, std::chrono::steady_clock::now() + this->window,
+                                    [&batch]() { return batch->sealed; });
+            this->seal(batch);
+            if (!batch->unbounded) {
+              options.deadline = batch->deadline;
+            }
+          }
+
+          // a sealed batch does not change until it is done
+          auto result = this->send(batch->request, options);
+
+          std::lock_guard<std::mutex> lock(this->mutex);
+          if (result) {
+            batch->result = std::move(*result);
+          } else {
+            batch->error = std::move(result).error();
+          }
+          batch->done = true;
+          this->changed.notify_all();
+          --this->in_flight;
+          this->idle.notify_all();
+        }).detach();
+      }
+    };
+  }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include "openai/http/request_options.hpp"
+
+namespace openai {
+  namespace http {
+    // Bounds the number of calls in flight.
+    // Callers wait for a permit, up to their deadline and until they are cancelled.
+    class ConcurrencyLimiter {
+     private:
+      std::mutex mutex;
+      std::condition_variable released;
+      size_t limit;
+      size_t in_use = 0;
+
+     public:
+      // RAII permit, released on destruction
+      class Permit {
+       private:
+        ConcurrencyLimiter *limiter;
+
+       public:
+        explicit Permit(ConcurrencyLimiter *limiter) : limiter(limiter) {}
+        Permit(Permit &&other) noexcept : limiter(other.limiter) { other.limiter = nullptr; }
+        Permit &operator=(Permit &&other) noexcept {
+          if (this != &other) {
+            if (this->limiter) {
+              this->limiter->release();
+            }
+            this->limiter = other.limiter;
+            other.limiter = nullptr;
+          }
+          return *this;
+        }
+        Permit(const Permit &) = delete;
+        Permit &operator=(const Permit &) = delete;
+
+        ~Permit() {
+          if (this->limiter) {
+            this->limiter->release();
+          }
+        }
+      };
+
+      explicit ConcurrencyLimiter(size_t limit) : limit(limit == 0 ? 1 : limit) {}
+
+      // Wait for a permit. Returns nothing when the options expire or are cancelled first
+      std::optional<Permit> acquire(const RequestOptions &options = {}) {
+        std::atomic<bool> cancelled{false};
+        CancellationScope scope(options, [this, &cancelled]() {
+          cancelled = true;
+          this->released.notify_all();
+        });
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (this->in_use >= this->limit) {
+          if (cancelled || options.is_expired()) {
+            return std::nullopt;
+          }
+          // bounded wait: a cancellation may be notified right before we wait
+          auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+          if (options.deadline) {
+            until = std::min(until, *options.deadline);
+          }
+          this->released.wait_until(lock, until);
+        }
+        ++this->in_use;
+        return Permit(this);
+      }
+
+      size_t in_flight() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->in_use;
+      }
+
+     private:
+      void release() {
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          --this->in_use;
+        }
+        this->released.notify_all();
+      }
+    };
+  }
+}
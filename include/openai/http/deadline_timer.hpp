@@ -0,0 +1,164 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include "openai/http/request_options.hpp"
+
+namespace openai {
+  namespace http {
+    // Runs callbacks once their time point passes, from one background thread started on first use.
+    // Socket timeouts only bound each send and read: a slow trickle or a large body can keep a call running
+    //  past its deadline, so calls with a deadline are also stopped from here.
+    class DeadlineTimer {
+     public:
+      using Handle = std::pair<std::chrono::steady_clock::time_point, uint64_t>;
+
+     private:
+      std::mutex mutex;
+      std::condition_variable changed;
+      std::condition_variable finished;
+      // ordered by time point, then by id
+      std::map<Handle, std::function<void()>> queue;
+      uint64_t next_id = 1;
+      // id of the callback running, 0 when none
+      uint64_t running = 0;
+      bool stopping = false;
+      std::thread thread;
+
+      void run() {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (!this->stopping) {
+          if (this->queue.empty()) {
+            this->changed.wait(lock);
+            continue;
+          }
+          auto first = this->queue.begin();
+          const auto at = first->first.first;
+          if (at > std::chrono::steady_clock::now()) {
+            this->changed.wait_until(lock, at);
+            continue;
+          }
+
+          auto callback = std::move(first->second);
+          this->running = first->first.second;
+          this->queue.erase(first);
+          lock.unlock();
+          callback();
+          lock.lock();
+          this->running = 0;
+          this->finished.notify_all();
+        }
+      }
+
+     public:
+      DeadlineTimer() = default;
+
+      DeadlineTimer(const DeadlineTimer &) = delete;
+      DeadlineTimer &operator=(const DeadlineTimer &) = delete;
+
+      ~DeadlineTimer() {
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->stopping = true;
+        }
+        this->changed.notify_all();
+        if (this->thread.joinable()) {
+          this->thread.join();
+        }
+      }
+
+      // Run `callback` on the timer thread once `at` has passed
+      Handle schedule(std::chrono::steady_clock::time_point at, std::function<void()> callback) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->thread.joinable()) {
+          this->thread = std::thread([this]() { this->run(); });
+        }
+        const Handle handle{at, this->next_id++};
+        const auto inserted = this->queue.emplace(handle, std::move(callback)).first;
+        if (inserted == this->queue.begin()) {
+          this->changed.notify_all();
+        }
+        return handle;
+      }
+
+      // Once this returns the callback is not running and will never run.
+      // Must not be called from a callback.
+      void cancel(const Handle &handle) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->queue.erase(handle);
+        this->finished.wait(lock, [this, &handle]() { return this->running != handle.second; });
+      }
+    };
+
+    // Stops a call in flight when it is cancelled or reaches its deadline, for the duration of a scope.
+    // httplib::Client::stop() does nothing before the request holds its socket:
+    //  once triggered, `stop` is called again every `retry` until the scope ends.
+    class StopScope {
+     private:
+      static constexpr std::chrono::milliseconds retry{5};
+
+      struct State {
+        DeadlineTimer &timer;
+        std::function<void()> stop;
+        std::mutex mutex;
+        bool done = false;
+        std::optional<DeadlineTimer::Handle> next;
+
+        State(DeadlineTimer &timer, std::function<void()> stop) : timer(timer), stop(std::move(stop)) {}
+
+        static void trigger(const std::shared_ptr<State> &state) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          if (state->done) {
+            return;
+          }
+          state->stop();
+          state->next = state->timer.schedule(std::chrono::steady_clock::now() + retry,
+                                              [state]() { State::trigger(state); });
+        }
+      };
+
+      std::shared_ptr<State> state;
+      std::optional<CancellationScope> cancellation;
+      std::optional<DeadlineTimer::Handle> deadline;
+
+     public:
+      StopScope(DeadlineTimer &timer, const RequestOptions &options, std::function<void()> stop)
+          : state(std::make_shared<State>(timer, std::move(stop))) {
+        if (options.deadline) {
+          this->deadline = timer.schedule(*options.deadline, [state = this->state]() { State::trigger(state); });
+        }
+        if (options.cancellation) {
+          this->cancellation.emplace(options, [state = this->state]() { State::trigger(state); });
+        }
+      }
+
+      StopScope(const StopScope &) = delete;
+      StopScope &operator=(const StopScope &) = delete;
+
+      ~StopScope() {
+        std::optional<DeadlineTimer::Handle> next;
+        {
+          std::lock_guard<std::mutex> lock(this->state->mutex);
+          this->state->done = true;
+          next = this->state->next;
+        }
+        // `stop` is not called anymore: only the pending timers are left to remove
+        this->cancellation.reset();
+        if (this->deadline) {
+          this->state->timer.cancel(*this->deadline);
+        }
+        if (next) {
+          this->state->timer.cancel(*next);
+        }
+      }
+    };
+  }
+}
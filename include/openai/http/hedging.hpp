@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+
+namespace openai {
+  namespace http {
+    // Hedged requests: when a call takes longer than most recent calls to the same endpoint,
+    //  a duplicate is sent on another connection and the first response wins.
+    //
+    // see: "The Tail at Scale", Dean & Barroso
+    struct HedgingPolicy {
+      // Hedging is opt-in
+      bool enabled = false;
+      // A duplicate is sent once the call is slower than this percentile of the recent latencies of the endpoint
+      double percentile = 0.95;
+      // No hedging until the endpoint has this many latency samples
+      size_t min_samples = 20;
+      // Maximum extra load, as a fraction of the traffic. 0.05 = at most 5% of the requests are duplicated
+      double max_extra_load = 0.05;
+      // Never hedge before this delay, even if the endpoint is very fast
+      std::chrono::milliseconds min_delay{10};
+      // POST endpoints (see `endpoint_key`) that are safe to send twice. GET requests are always eligible.
+      // Never add endpoints that create resources such as files or fine-tunes.
+      std::unordered_set<std::string> endpoints = {
+          "/v1/chat",
+          "/v1/completions",
+          "/v1/edits",
+          "/v1/embeddings",
+          "/v1/moderations",
+      };
+    };
+
+    // Caps the number of duplicated requests to a fraction of the traffic
+    class HedgingBudget {
+     private:
+      std::atomic<uint64_t> requests{0};
+      std::atomic<uint64_t> hedges{0};
+
+      // counters are halved past this point so the budget follows the recent traffic
+      static constexpr uint64_t decay_after = 10000;
+
+     public:
+      void on_request() {
+        if (this->requests.fetch_add(1, std::memory_order_relaxed) + 1 > decay_after) {
+          this->requests.store(decay_after / 2, std::memory_order_relaxed);
+          this->hedges.store(this->hedges.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+        }
+      }
+
+      // Reserve a duplicate request if the budget allows it
+      bool try_acquire(double max_extra_load) {
+        const auto allowed = static_cast<uint64_t>(
+            max_extra_load * static_cast<double>(this->requests.load(std::memory_order_relaxed)));
+        auto used = this->hedges.load(std::memory_order_relaxed);
+        while (used < allowed) {
+          if (this->hedges.compare_exchange_weak(used, used + 1, std::memory_order_relaxed)) {
+            return true;
+          }
+        }
+        return false;
+      }
+    };
+  }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace openai {
+  namespace http {
+    // Reduce a request path to the endpoint it targets, so per-endpoint statistics
+    //  are shared between calls on different resources.
+    // Eg: "/v1/files/file-123/content" -> "/v1/files", "/v1/chat/completions" -> "/v1/chat"
+    inline std::string endpoint_key(const std::string &path) {
+      const auto end = path.find('?');
+      size_t pos = 0;
+      for (int segment = 0; segment < 2; ++segment) {
+        pos = path.find('/', pos + 1);
+        if (pos == std::string::npos || pos >= end) {
+          return path.substr(0, end);
+        }
+      }
+      return path.substr(0, pos);
+    }
+
+    // Keeps the most recent latencies of every endpoint in a fixed size ring buffer
+    //  and answers percentile queries on them.
+    class LatencyTracker {
+     private:
+      struct Window {
+        std::vector<std::chrono::microseconds> samples;
+        size_t next = 0;
+      };
+
+      size_t capacity;
+      std::mutex mutex;
+      std::unordered_map<std::string, Window> windows;
+
+     public:
+      explicit LatencyTracker(size_t capacity = 256) : capacity(capacity) {}
+
+      void record(const std::string &endpoint, std::chrono::microseconds latency) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto &window = this->windows[endpoint];
+        if (window.samples.size() < this->capacity) {
+          window.samples.push_back(latency);
+        } else {
+          window.samples[window.next] = latency;
+          window.next = (window.next + 1) % this->capacity;
+        }
+      }
+
+      // Latency under which `percentile` (0 to 1) of the recent calls completed.
+      // Empty while the endpoint has less than `min_samples` samples.
+      std::optional<std::chrono::microseconds> percentile(const std::string &endpoint,
+                                                          double percentile,
+                                                          size_t min_samples) {
+        thread_local std::vector<std::chrono::microseconds> scratch;
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          const auto it = this->windows.find(endpoint);
+          if (it == this->windows.end() || it->second.samples.size() < std::max<size_t>(min_samples, 1)) {
+            return std::nullopt;
+          }
+          scratch.assign(it->second.samples.begin(), it->second.samples.end());
+        }
+
+        const auto rank = static_cast<size_t>(percentile * static_cast<double>(scratch.size() - 1));
+        std::nth_element(scratch.begin(), scratch.begin() + rank, scratch.end());
+        return scratch[rank];
+      }
+    };
+  }
+}
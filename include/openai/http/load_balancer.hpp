@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../lib/httplib.hpp"
+#include "openai/http/circuit_breaker.hpp"
+#include "openai/http/client_pool.hpp"
+
+namespace openai {
+  namespace http {
+    enum LOAD_BALANCING_STRATEGY {
+      // send to the target with the fewest requests in flight
+      least_outstanding_requests,
+      // random pick, proportional to the target weight
+      weighted_random,
+    };
+
+    // One upstream: a domain and the headers (API key, organization) to use with it
+    struct Target {
+      std::string domain;
+      httplib::Headers headers;
+      // relative share of the traffic with `weighted_random`, and tie-breaker with `least_outstanding_requests`
+      unsigned weight = 1;
+    };
+
+    // When to take a failing target out of the rotation
+    struct HealthPolicy {
+      // consecutive failures (transport error, 429 or 5xx) before a target is ejected
+      int max_consecutive_failures = 5;
+      // first ejection duration, doubled on every new ejection of the same target
+      std::chrono::milliseconds base_ejection{1000};
+      std::chrono::milliseconds max_ejection{60000};
+      // number of other targets a failed call can be retried on
+      size_t max_failover = 2;
+      // per endpoint circuit breakers of every target
+      CircuitBreakerPolicy circuit_breaker;
+    };
+
+    class TargetState {
+     public:
+      const std::shared_ptr<ClientPool> pool;
+      const unsigned weight;
+      CircuitBreakers breakers;
+
+     private:
+      std::atomic<int> outstanding{0};
+
+      std::mutex mutex;
+      int consecutive_failures = 0;
+      int ejections = 0;
+      std::chrono::steady_clock::time_point ejected_until{};
+
+     public:
+      TargetState(const Target &target, const HealthPolicy &policy)
+          : pool(std::make_shared<ClientPool>(target.domain, target.headers)),
+            weight(std::max(target.weight, 1u)),
+            breakers(policy.circuit_breaker) {}
+
+      int in_flight() const { return this->outstanding.load(std::memory_order_relaxed); }
+
+      bool is_available(std::chrono::steady_clock::time_point now) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return now >= this->ejected_until;
+      }
+
+      std::chrono::steady_clock::time_point available_at() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->ejected_until;
+      }
+
+      void begin() { this->outstanding.fetch_add(1, std::memory_order_relaxed); }
+
+      // Record the outcome of a call. A success re-admits the target for good.
+      void end(bool failed, const HealthPolicy &policy) {
+        this->outstanding.fetch_sub(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!failed) {
+          this->consecutive_failures = 0;
+          this->ejections = 0;
+          return;
+        }
+
+        if (++this->consecutive_failures < policy.max_consecutive_failures) {
+          return;
+        }
+        // eject, longer every time the target fails again right after being re-admitted
+        const auto factor = 1LL << std::min(this->ejections, 16);
+        const auto duration = std::min<std::chrono::milliseconds>(policy.base_ejection * factor, policy.max_ejection);
+        this->ejected_until = std::chrono::steady_clock::now() + duration;
+        this->ejections++;
+        this->consecutive_failures = 0;
+      }
+    };
+
+    // Spreads requests over a set of targets, and ejects the failing ones for a while
+    class LoadBalancer {
+     private:
+      std::vector<std::unique_ptr<TargetState>> targets;
+      LOAD_BALANCING_STRATEGY strategy;
+
+     public:
+      const HealthPolicy health_policy;
+
+      LoadBalancer(const std::vector<Target> &targets,
+                   LOAD_BALANCING_STRATEGY strategy = least_outstanding_requests,
+                   HealthPolicy health_policy = {})
+          : strategy(strategy), health_policy(std::move(health_policy)) {
+        if (targets.empty()) {
+          throw std::invalid_argument("load balancer: at least one target is required");
+        }
+        for (const auto &target : targets) {
+          this->targets.push_back(std::make_unique<TargetState>(target, this->health_policy));
+        }
+      }
+
+      size_t size() const { return this->targets.size(); }
+
+      // Select a target for the next call, skipping `exclude` when there is another choice.
+      // If every target is ejected, the one that comes back first is used anyway.
+      TargetState *pick(const TargetState *exclude = nullptr) {
+        if (this->targets.size() == 1) {
+          return this->targets.front().get();
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        thread_local std::vector<TargetState *> candidates;
+        candidates.clear();
+        for (const auto &target : this->targets) {
+          if (target.get() != exclude && target->is_available(now)) {
+            candidates.push_back(target.get());
+          }
+        }
+
+        if (candidates.empty()) {
+          TargetState *soonest = nullptr;
+          for (const auto &target : this->targets) {
+            if (target.get() != exclude && (soonest == nullptr || target->available_at() < soonest->available_at())) {
+              soonest = target.get();
+            }
+          }
+          return soonest;
+        }
+
+        if (this->strategy == weighted_random) {
+          return pick_weighted(candidates);
+        }
+        return pick_least_outstanding(candidates);
+      }
+
+     private:
+      static TargetState *pick_least_outstanding(const std::vector<TargetState *> &candidates) {
+        // compare in_flight / weight without dividing
+        return *std::min_element(candidates.begin(), candidates.end(), [](TargetState *a, TargetState *b) {
+          return static_cast<long long>(a->in_flight()) * b->weight < static_cast<long long>(b->in_flight()) * a->weight;
+        });
+      }
+
+      static TargetState *pick_weighted(const std::vector<TargetState *> &candidates) {
+        thread_local std::minstd_rand random{std::random_device{}()};
+        unsigned total = 0;
+        for (const auto *target : candidates) {
+          total += target->weight;
+        }
+        auto ticket = std::uniform_int_distribution<unsigned>(0, total - 1)(random);
+        for (auto *target : candidates) {
+          if (ticket < target->weight) {
+            return target;
+          }
+          ticket -= target->weight;
+        }
+        return candidates.back();
+      }
+    };
+  }
+}
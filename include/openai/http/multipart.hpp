@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "../../lib/httplib.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace openai {
+  namespace http {
+    // Read-only file opened for positional reads.
+    // On POSIX systems the file is also memory mapped when possible, so its pages
+    //  can be handed to the socket without being copied to a buffer first.
+    class FileReader {
+     private:
+#ifndef _WIN32
+      int fd = -1;
+      void *mapping = nullptr;
+#else
+      std::ifstream stream;
+#endif
+      uint64_t file_size = 0;
+
+     public:
+      explicit FileReader(const std::string &path) {
+#ifndef _WIN32
+        this->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat info{};
+        if (this->fd < 0 || ::fstat(this->fd, &info) != 0) {
+          if (this->fd >= 0) {
+            ::close(this->fd);
+          }
+          throw std::runtime_error("cannot open file: " + path + ": " + std::strerror(errno));
+        }
+        this->file_size = static_cast<uint64_t>(info.st_size);
+
+        if (this->file_size > 0) {
+          this->mapping = ::mmap(nullptr, this->file_size, PROT_READ, MAP_PRIVATE, this->fd, 0);
+          if (this->mapping == MAP_FAILED) {
+            // fall back to pread
+            this->mapping = nullptr;
+          } else {
+            ::madvise(this->mapping, this->file_size, MADV_SEQUENTIAL);
+          }
+        }
+#else
+        this->stream.open(path, std::ios::binary | std::ios::ate);
+        if (!this->stream) {
+          throw std::runtime_error("cannot open file: " + path);
+        }
+        this->file_size = static_cast<uint64_t>(this->stream.tellg());
+#endif
+      }
+
+      FileReader(const FileReader &) = delete;
+      FileReader &operator=(const FileReader &) = delete;
+
+      ~FileReader() {
+#ifndef _WIN32
+        if (this->mapping) {
+          ::munmap(this->mapping, this->file_size);
+        }
+        if (this->fd >= 0) {
+          ::close(this->fd);
+        }
+#endif
+      }
+
+      uint64_t size() const { return this->file_size; }
+
+      // The whole file content when it is memory mapped, nullptr otherwise
+      const char *data() const {
+#ifndef _WIN32
+        return static_cast<const char *>(this->mapping);
+#else
+        return nullptr;
+#endif
+      }
+
+      // Read up to `length` bytes at `offset`, returns the number of bytes read
+      size_t read_at(uint64_t offset, char *buffer, size_t length) {
+#ifndef _WIN32
+        size_t total = 0;
+        while (total < length) {
+          const auto n = ::pread(this->fd, buffer + total, length - total, static_cast<off_t>(offset + total));
+          if (n < 0 && errno == EINTR) {
+            continue;
+          }
+          if (n <= 0) {
+            break;
+          }
+          total += static_cast<size_t>(n);
+        }
+        return total;
+#else
+        this->stream.clear();
+        this->stream.seekg(static_cast<std::streamoff>(offset));
+        this->stream.read(buffer, static_cast<std::streamsize>(length));
+        return static_cast<size_t>(this->stream.gcount());
+#endif
+      }
+    };
+
+    // A multipart/form-data body streamed to the socket part by part.
+    // File parts are sent from their memory mapping, or read in fixed-size chunks when
+    //  the file cannot be mapped, so the memory used does not depend on the file size.
+    // Data parts reference the caller's buffer instead of copying it.
+    // Can be sent several times (retries).
+    class MultipartBody {
+     private:
+      struct Segment {
+        // in memory data, used when `file` and `external` are null
+        std::string data;
+        // caller owned data, see add_data
+        const char *external = nullptr;
+        std::shared_ptr<FileReader> file;
+        // where the segment starts in `file`
+        uint64_t offset = 0;
+        uint64_t size = 0;
+      };
+
+      std::string boundary;
+      std::vector<Segment> segments;
+      uint64_t total_size = 0;
+      bool finished = false;
+
+      size_t chunk_size;
+      std::vector<char> chunk;
+
+     public:
+      explicit MultipartBody(size_t chunk_size = 64 * 1024) : chunk_size(chunk_size) {
+        static const char alphabet[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        thread_local std::mt19937 random{std::random_device{}()};
+        std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 2);
+        this->boundary = "--------------------------openai-";
+        for (int i = 0; i < 24; ++i) {
+          this->boundary += alphabet[pick(random)];
+        }
+      }
+
+      // Add a text field
+      void add_field(const std::string &name, const std::string &value) {
+        this->add_memory(this->part_header(name, "", ""));
+        this->add_memory(value);
+        this->add_memory("\r\n");
+      }
+
+      // Add a file part whose content is streamed from `path` when the body is sent
+      void add_file(const std::string &name,
+                    const std::string &path,
+                    const std::string &filename,
+                    const std::string &content_type = "application/octet-stream") {
+        auto file = std::make_shared<FileReader>(path);
+        this->add_memory(this->part_header(name, filename, content_type));
+        this->segments.push_back({{}, nullptr, file, 0, file->size()});
+        this->total_size += file->size();
+        this->add_memory("\r\n");
+      }
+
+      // Add a file part made of `prefix` followed by `length` bytes of `file` from `offset`.
+      // Sends a slice of a file without copying it, eg one piece of a long recording behind its own header.
+      void add_file_range(const std::string &name,
+                          std::shared_ptr<FileReader> file,
+                          uint64_t offset,
+                          uint64_t length,
+                          const std::string &filename,
+                          const std::string &content_type = "application/octet-stream",
+                          const std::string &prefix = "") {
+        this->add_memory(this->part_header(name, filename, content_type) + prefix);
+        this->segments.push_back({{}, nullptr, std::move(file), offset, length});
+        this->total_size += length;
+        this->add_memory("\r\n");
+      }
+
+      // Add a file part whose content is `data`.
+      // The data is not copied: it must stay alive and unchanged until the body is sent.
+      void add_data(const std::string &name,
+                    std::string_view data,
+                    const std::string &filename,
+                    const std::string &content_type = "application/octet-stream") {
+        this->add_memory(this->part_header(name, filename, content_type));
+        Segment segment;
+        segment.external = data.data();
+        segment.size = data.size();
+        this->segments.push_back(std::move(segment));
+        this->total_size += data.size();
+        this->add_memory("\r\n");
+      }
+
+      // Must be called once every part is added
+      void finish() {
+        if (!this->finished) {
+          this->add_memory("--" + this->boundary + "--\r\n");
+          this->finished = true;
+        }
+      }
+
+      uint64_t content_length() const { return this->total_size; }
+
+      std::string content_type() const { return "multipart/form-data; boundary=" + this->boundary; }
+
+      // httplib::ContentProvider: write the bytes starting at `offset`, one chunk at most
+      bool provide(size_t offset, size_t length, httplib::DataSink &sink) {
+        uint64_t segment_start = 0;
+        for (const auto &segment : this->segments) {
+          if (offset >= segment_start + segment.size) {
+            segment_start += segment.size;
+            continue;
+          }
+
+          const auto in_segment = offset - segment_start;
+          const auto count = static_cast<size_t>(std::min<uint64_t>({segment.size - in_segment, length, this->chunk_size}));
+          if (segment.external) {
+            return sink.write(segment.external + in_segment, count);
+          }
+          if (!segment.file) {
+            return sink.write(segment.data.data() + in_segment, count);
+          }
+          if (segment.file->data()) {
+            return sink.write(segment.file->data() + segment.offset + in_segment, count);
+          }
+
+          this->chunk.resize(this->chunk_size);
+          const auto read = segment.file->read_at(segment.offset + in_segment, this->chunk.data(), count);
+          // the file shrank since it was added
+          return read == count && sink.write(this->chunk.data(), read);
+        }
+        return false;
+      }
+
+     private:
+      std::string part_header(const std::string &name, const std::string &filename, const std::string &content_type) const {
+        std::string header = "--" + this->boundary + "\r\nContent-Disposition: form-data; name=\"" + name + "\"";
+        if (!filename.empty()) {
+          header += "; filename=\"" + filename + "\"";
+        }
+        header += "\r\n";
+        if (!content_type.empty()) {
+          header += "Content-Type: " + content_type + "\r\n";
+        }
+        header += "\r\n";
+        return header;
+      }
+
+      void add_memory(std::string data) {
+        const auto size = data.size();
+        this->segments.push_back({std::move(data), nullptr, nullptr, 0, size});
+        this->total_size += size;
+      }
+    };
+  }
+}
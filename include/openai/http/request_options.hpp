@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace openai {
+  namespace http {
+    // Cancel calls in flight from another thread. Eg: when your own client disconnects.
+    // The same token can be shared by several calls.
+    class CancellationToken {
+     private:
+      std::mutex mutex;
+      bool cancelled = false;
+      uint64_t next_id = 1;
+      std::unordered_map<uint64_t, std::function<void()>> callbacks;
+
+     public:
+      static std::shared_ptr<CancellationToken> create() {
+        return std::make_shared<CancellationToken>();
+      }
+
+      // Cancel every call using this token, and every future call using it
+      void cancel() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->cancelled) {
+          return;
+        }
+        this->cancelled = true;
+        // run under the lock: `unsubscribe` must not return while its callback is running
+        for (auto &callback : this->callbacks) {
+          callback.second();
+        }
+        this->callbacks.clear();
+      }
+
+      bool is_cancelled() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->cancelled;
+      }
+
+      // Run `callback` on cancellation, or right away if already cancelled.
+      // Returns an id for `unsubscribe`, 0 when the callback already ran.
+      uint64_t subscribe(std::function<void()> callback) {
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          if (!this->cancelled) {
+            const auto id = this->next_id++;
+            this->callbacks.emplace(id, std::move(callback));
+            return id;
+          }
+        }
+        callback();
+        return 0;
+      }
+
+      // Once this returns the callback is not running and will never run
+      void unsubscribe(uint64_t id) {
+        if (id == 0) {
+          return;
+        }
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->callbacks.erase(id);
+      }
+    };
+
+    // Thrown when a call is cancelled with its CancellationToken
+    class CancelledError : public std::runtime_error {
+     public:
+      CancelledError() : std::runtime_error("call cancelled") {}
+    };
+
+    // Thrown when a call could not complete before its deadline
+    class DeadlineExceededError : public std::runtime_error {
+     public:
+      DeadlineExceededError() : std::runtime_error("deadline exceeded") {}
+    };
+
+    // Per call options, accepted by every API method
+    struct RequestOptions {
+      // Absolute time after which the call is abandoned, retries and hedged duplicates included.
+      // Bounds the connection and every send and read on the socket, and stops the call in flight once passed.
+      std::optional<std::chrono::steady_clock::time_point> deadline;
+      // Cancel the call from another thread, the socket is shut down right away
+      std::shared_ptr<CancellationToken> cancellation;
+
+      // Helper: deadline `timeout` from now
+      static RequestOptions with_timeout(std::chrono::steady_clock::duration timeout) {
+        RequestOptions options;
+        options.deadline = std::chrono::steady_clock::now() + timeout;
+        return options;
+      }
+
+      bool is_cancelled() const {
+        return this->cancellation && this->cancellation->is_cancelled();
+      }
+
+      bool is_expired() const {
+        return this->deadline && std::chrono::steady_clock::now() >= *this->deadline;
+      }
+
+      // Throw if the call must not go on
+      void check() const {
+        if (this->is_cancelled()) {
+          throw CancelledError();
+        }
+        if (this->is_expired()) {
+          throw DeadlineExceededError();
+        }
+      }
+    };
+
+    // Keeps a cancellation callback registered for the duration of a scope
+    class CancellationScope {
+     private:
+      std::shared_ptr<CancellationToken> token;
+      uint64_t id = 0;
+
+     public:
+      CancellationScope(const RequestOptions &options, std::function<void()> on_cancel)
+          : token(options.cancellation) {
+        if (this->token) {
+          this->id = this->token->subscribe(std::move(on_cancel));
+        }
+      }
+
+      CancellationScope(const CancellationScope &) = delete;
+      CancellationScope &operator=(const CancellationScope &) = delete;
+
+      ~CancellationScope() {
+        if (this->token) {
+          this->token->unsubscribe(this->id);
+        }
+      }
+    };
+  }
+}
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "openai/api_utils.hpp"
+#include "openai/base64.hpp"
+#include "openai/enums.hpp"
+#include "openai/http/client_pool.hpp"
+#include "openai/http/deadline_timer.hpp"
+#include "openai/models/image_generation.hpp"
+
+namespace openai {
+  struct ImageBatchOptions {
+    IMAGE_SIZE size = IMAGE_SIZE::px_1024_1024;
+    // images generated for each prompt
+    int images_per_prompt = 1;
+    // generation calls in flight
+    size_t max_concurrent_requests = 4;
+    // image downloads in flight, over pooled connections to the image host
+    size_t max_concurrent_downloads = 8;
+    // b64_json: the images come within the generation response and are decoded from it,
+    //  there is nothing to download
+    IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::url;
+    // When set, every image is written to `<output_dir>/<prompt index>_<image index>.png`
+    //  as it is downloaded instead of being kept in memory
+    std::string output_dir;
+  };
+
+  struct ImageBatchResult {
+    size_t prompt_index = 0;
+    size_t image_index = 0;
+    // empty with IMAGE_RESPONSE_FORMAT::b64_json
+    std::string url;
+    // the PNG bytes, empty when written to `path`
+    std::string data;
+    std::string path;
+    // set when the generation or the download failed
+    std::optional<Error> error;
+  };
+
+  // Generates images for many prompts in parallel and downloads them as soon as their URL is known
+  //  (or decodes them, with IMAGE_RESPONSE_FORMAT::b64_json).
+  // Results are handed to the callback as each image finishes, one call at a time,
+  //  from the worker threads.
+  //
+  // Eg:
+  //  api.generate_images({"a cat", "a dog"}, [](openai::ImageBatchResult &&image) {
+  //    std::cout << image.prompt_index << ": " << image.data.size() << " bytes" << std::endl;
+  //  });
+  class ImageBatch {
+   private:
+    http::HttpClient *http_client;
+    ImageBatchOptions options;
+
+    // connections to the image hosts, without the API credentials
+    std::mutex pools_mutex;
+    std::map<std::string, std::shared_ptr<http::ClientPool>> pools;
+    // stop the downloads in flight when they are cancelled or reach their deadline
+    http::DeadlineTimer deadlines;
+
+   public:
+    explicit ImageBatch(http::HttpClient *http_client, ImageBatchOptions options = {})
+        : http_client(http_client), options(std::move(options)) {}
+
+    // Blocks until every image is generated and downloaded, or failed
+    void run(const std::vector<std::string> &prompts,
+             const std::function<void(ImageBatchResult &&result)> &on_image,
+             const http::RequestOptions &request_options = {}) {
+      std::mutex mutex;
+      std::condition_variable changed;
+      std::deque<ImageBatchResult> downloads;
+      size_t generating = std::min(this->options.max_concurrent_requests, prompts.size());
+
+      std::mutex callback_mutex;
+      const auto deliver = [&](ImageBatchResult &&result) {
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        on_image(std::move(result));
+      };
+
+      std::atomic<size_t> next_prompt{0};
+      std::vector<std::thread> workers;
+      for (size_t i = 0; i < generating; ++i) {
+        workers.emplace_back([&]() {
+          for (auto index = next_prompt++; index < prompts.size(); index = next_prompt++) {
+            auto generated = this->generate(index, prompts[index], request_options);
+            if (!generated) {
+              ImageBatchResult failed;
+              failed.prompt_index = index;
+              failed.error = std::move(generated).error();
+              deliver(std::move(failed));
+              continue;
+            }
+            auto &results = *generated;
+            // decoded images are delivered as they are, including the ones that failed to decode or write
+            if (this->options.response_format == IMAGE_RESPONSE_FORMAT::b64_json) {
+              for (auto &result : results) {
+                deliver(std::move(result));
+              }
+              continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &result : results) {
+              downloads.push_back(std::move(result));
+            }
+            changed.notify_all();
+          }
+          std::lock_guard<std::mutex> lock(mutex);
+          --generating;
+          changed.notify_all();
+        });
+      }
+
+      const auto downloaders = std::max<size_t>(1, this->options.max_concurrent_downloads);
+      for (size_t i = 0; i < downloaders; ++i) {
+        workers.emplace_back([&]() {
+          while (true) {
+            ImageBatchResult result;
+            {
+              std::unique_lock<std::mutex> lock(mutex);
+              changed.wait(lock, [&]() { return !downloads.empty() || generating == 0; });
+              if (downloads.empty()) {
+                return;
+              }
+              result = std::move(downloads.front());
+              downloads.pop_front();
+            }
+            this->download(result, request_options);
+            deliver(std::move(result));
+          }
+        });
+      }
+
+      for (auto &worker : workers) {
+        worker.join();
+      }
+    }
+
+   private:
+    // One result per image of the prompt, or the error of the generation call
+    Expected<std::vector<ImageBatchResult>> generate(size_t index,
+                                                     const std::string &prompt,
+                                                     const http::RequestOptions &request_options) {
+      models::ImagesGenerationsRequest request;
+      request.prompt = prompt;
+      request.n = this->options.images_per_prompt;
+      request.size = to_str(this->options.size);
+      request.response_format = to_str(this->options.response_format);
+
+      auto response = this->http_client->try_post_view<models::ImagesGenerationsRequest, models::ImagesResponseView>(
+          "/v1/images/generations", request, request_options
+      );
+      if (!response) {
+        return std::move(response).error();
+      }
+
+      std::vector<ImageBatchResult> results;
+
+      const auto &data = (*response)->value.data;
+      for (size_t i = 0; i < data.size(); ++i) {
+        ImageBatchResult result;
+        result.prompt_index = index;
+        result.image_index = i;
+        if (data[i].b64_json) {
+          this->decode(result, *data[i].b64_json);
+        } else {
+          result.url = data[i].url.value_or("");
+        }
+        results.push_back(std::move(result));
+      }
+      return results;
+    }
+
+    // Decode a b64_json image, straight from the response body
+    void decode(ImageBatchResult &result, std::string_view b64_json) {
+      result.data.resize(base64_decoded_size(b64_json));
+      auto size = base64_decode(b64_json, result.data.data());
+      if (!size) {
+        Error error;
+        error.kind = error_parse;
+        error.status = 200;
+        error.path = "/v1/images/generations";
+        error.detail = "invalid base64 image";
+        result.data.clear();
+        result.error = std::move(error);
+        return;
+      }
+      result.data.resize(*size);
+
+      if (!this->options.output_dir.empty()) {
+        result.path = this->image_path(result);
+        std::ofstream file(result.path, std::ios::binary | std::ios::trunc);
+        file.write(result.data.data(), static_cast<std::streamsize>(result.data.size()));
+        result.data.clear();
+        if (!file.good()) {
+          Error error;
+          error.kind = error_io;
+          error.path = result.path;
+          error.detail = "cannot write image";
+          result.error = std::move(error);
+        }
+      }
+    }
+
+    void download(ImageBatchResult &result, const http::RequestOptions &request_options) {
+      if (request_options.is_cancelled() || request_options.is_expired()) {
+        Error error;
+        error.kind = request_options.is_cancelled() ? error_cancelled : error_deadline_exceeded;
+        error.path = result.url;
+        result.error = std::move(error);
+        return;
+      }
+
+      // "https://host/path?query" -> "https://host" + "/path?query"
+      const auto scheme_end = result.url.find("://");
+      const auto path_start = scheme_end == std::string::npos ? std::string::npos : result.url.find('/', scheme_end + 3);
+      if (path_start == std::string::npos) {
+        Error error;
+        error.kind = error_parse;
+        error.path = result.url;
+        error.detail = "invalid image url";
+        result.error = std::move(error);
+        return;
+      }
+
+      std::ofstream file;
+      if (!this->options.output_dir.empty()) {
+        result.path = this->image_path(result);
+      }
+
+      int status = 0;
+      bool write_failed = false;
+      auto lease = this->pool(result.url.substr(0, path_start))->acquire();
+      lease->set_follow_location(true);
+      http::HttpClient::apply_timeouts(*lease, request_options.deadline);
+      http::StopScope stop_scope(this->deadlines, request_options, [&lease]() { lease->stop(); });
+      auto response = lease->Get(
+          result.url.substr(path_start),
+          [&](const httplib::Response &response) {
+            status = response.status;
+            if (status != 200) {
+              return false;
+            }
+            if (!result.path.empty()) {
+              file.open(result.path, std::ios::binary | std::ios::trunc);
+              write_failed = !file.is_open();
+              return !write_failed;
+            }
+            return true;
+          },
+          [&](const char *data, size_t length) {
+            if (file.is_open()) {
+              file.write(data, static_cast<std::streamsize>(length));
+              write_failed = !file.good();
+              return !write_failed;
+            }
+            result.data.append(data, length);
+            return true;
+          });
+
+      if (status == 200 && response) {
+        return;
+      }
+
+      Error error;
+      if (request_options.is_cancelled() || request_options.is_expired()) {
+        error.kind = request_options.is_cancelled() ? error_cancelled : error_deadline_exceeded;
+        error.path = result.url;
+      } else if (write_failed) {
+        error.kind = error_io;
+        error.path = result.path;
+        error.detail = "cannot write image";
+      } else {
+        error.kind = status != 0 && status != 200 ? error_http_status : error_transport;
+        error.path = result.url;
+        error.status = status;
+        error.transport_error = response.error();
+      }
+      result.data.clear();
+      result.error = std::move(error);
+    }
+
+    std::string image_path(const ImageBatchResult &result) const {
+      return this->options.output_dir + "/" + std::to_string(result.prompt_index) + "_"
+          + std::to_string(result.image_index) + ".png";
+    }
+
+    std::shared_ptr<http::ClientPool> pool(const std::string &origin) {
+      std::lock_guard<std::mutex> lock(this->pools_mutex);
+      auto &pool = this->pools[origin];
+      if (!pool) {
+        pool = std::make_shared<http::ClientPool>(origin, httplib::Headers{}, this->options.max_concurrent_downloads);
+      }
+      return pool;
+    }
+  };
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "openai/api_utils.hpp"
+#include "openai/enums.hpp"
+#include "openai/http/multipart.hpp"
+#include "openai/models/audio.hpp"
+
+namespace openai {
+  // Layout of a PCM or floating point WAV file, see read_wav_info
+  struct WavInfo {
+    // 1: integer PCM, 3: IEEE float
+    uint16_t format = 0;
+    uint16_t channels = 0;
+    uint32_t sample_rate = 0;
+    uint16_t bits_per_sample = 0;
+    // bytes per frame: one sample of every channel
+    uint16_t block_align = 0;
+    // the samples
+    uint64_t data_offset = 0;
+    uint64_t data_size = 0;
+
+    uint64_t frames() const { return this->data_size / this->block_align; }
+
+    double duration() const { return static_cast<double>(this->frames()) / this->sample_rate; }
+  };
+
+  namespace wav {
+    inline uint32_t read_u32(const unsigned char *data) {
+      return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+    }
+
+    inline uint16_t read_u16(const unsigned char *data) {
+      return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    inline void write_u32(std::string &out, uint32_t value) {
+      for (int i = 0; i < 4; ++i) {
+        out += static_cast<char>(value >> (8 * i));
+      }
+    }
+
+    inline void write_u16(std::string &out, uint16_t value) {
+      out += static_cast<char>(value);
+      out += static_cast<char>(value >> 8);
+    }
+
+    // Canonical 44 bytes header of a file holding `data_size` bytes of samples in the `info` format
+    inline std::string header(const WavInfo &info, uint64_t data_size) {
+      std::string out = "RIFF";
+      write_u32(out, static_cast<uint32_t>(36 + data_size));
+      out += "WAVEfmt ";
+      write_u32(out, 16);
+      write_u16(out, info.format);
+      write_u16(out, info.channels);
+      write_u32(out, info.sample_rate);
+      write_u32(out, info.sample_rate * info.block_align);
+      write_u16(out, info.block_align);
+      write_u16(out, info.bits_per_sample);
+      out += "data";
+      write_u32(out, static_cast<uint32_t>(data_size));
+      return out;
+    }
+
+    // Sample `index` of `frames`, scaled to [-1, 1]
+    inline double sample(const WavInfo &info, const unsigned char *frames, size_t index) {
+      const auto *data = frames + index * (info.bits_per_sample / 8);
+      switch (info.bits_per_sample) {
+        case 8:
+          return (int(data[0]) - 128) / 128.0;
+        case 16:
+          return static_cast<int16_t>(read_u16(data)) / 32768.0;
+        case 24:
+          return static_cast<int32_t>((uint32_t(data[0]) << 8) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 24)) /
+              2147483648.0;
+        case 32:
+          if (info.format == 3) {
+            float value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+          }
+          return static_cast<int32_t>(read_u32(data)) / 2147483648.0;
+        default: {
+          double value;
+          std::memcpy(&value, data, sizeof(value));
+          return value;
+        }
+      }
+    }
+  }
+
+  // Read the format and the position of the samples of a WAV file.
+  // Nothing when the file is not a PCM or floating point WAV.
+  inline std::optional<WavInfo> read_wav_info(http::FileReader &reader) {
+    unsigned char header[12];
+    if (reader.read_at(0, reinterpret_cast<char *>(header), sizeof(header)) != sizeof(header) ||
+        std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0) {
+      return std::nullopt;
+    }
+
+    WavInfo info;
+    bool has_format = false;
+    uint64_t offset = sizeof(header);
+    unsigned char chunk[8];
+    while (reader.read_at(offset, reinterpret_cast<char *>(chunk), sizeof(chunk)) == sizeof(chunk)) {
+      const uint64_t size = wav::read_u32(chunk + 4);
+      if (std::memcmp(chunk, "fmt ", 4) == 0) {
+        unsigned char format[26];
+        const auto read = reader.read_at(offset + 8, reinterpret_cast<char *>(format),
+                                         static_cast<size_t>(std::min<uint64_t>(size, sizeof(format))));
+        if (read < 16) {
+          return std::nullopt;
+        }
+        info.format = wav::read_u16(format);
+        info.channels = wav::read_u16(format + 2);
+        info.sample_rate = wav::read_u32(format + 4);
+        info.block_align = wav::read_u16(format + 12);
+        info.bits_per_sample = wav::read_u16(format + 14);
+        // WAVE_FORMAT_EXTENSIBLE: the format is the start of the sub format GUID
+        if (info.format == 0xfffe && read >= 26) {
+          info.format = wav::read_u16(format + 24);
+        }
+        has_format = true;
+      } else if (std::memcmp(chunk, "data", 4) == 0) {
+        info.data_offset = offset + 8;
+        // streamed files may not know their size
+        info.data_size = std::min<uint64_t>(size, reader.size() - info.data_offset);
+        break;
+      }
+      offset += 8 + size + (size & 1);
+    }
+
+    const bool supported = (info.format == 1 && (info.bits_per_sample == 8 || info.bits_per_sample == 16 ||
+                                                 info.bits_per_sample == 24 || info.bits_per_sample == 32)) ||
+        (info.format == 3 && (info.bits_per_sample == 32 || info.bits_per_sample == 64));
+    if (!has_format || !supported || info.data_offset == 0 || info.channels == 0 || info.sample_rate == 0 ||
+        info.block_align != info.channels * (info.bits_per_sample / 8)) {
+      return std::nullopt;
+    }
+    return info;
+  }
+
+  struct LongAudioOptions {
+    std::string model = "whisper-1";
+    // Use /v1/audio/translations: the transcript is in English
+    bool translate = false;
+    // Vocabulary or style hint, sent with every chunk
+    std::string prompt;
+    double temperature = 0;
+    // ISO-639-1 language of the audio, transcriptions only
+    std::string language;
+
+    // Target duration of a chunk, also bounded by `max_chunk_bytes`
+    double chunk_seconds = 600;
+    // Cut at the quietest moment within this many seconds before the target cut. 0 to cut at fixed windows
+    double silence_search_seconds = 20;
+    // Audio repeated at the start of each chunk, so words on a cut are heard whole once.
+    //  The segments are deduplicated by their timestamps.
+    double overlap_seconds = 0;
+    // The API rejects files over 25MB
+    uint64_t max_chunk_bytes = 24 * 1024 * 1024;
+
+    // Chunks transcribed at once. Consecutive chunks are sent one after the other on a lane,
+    //  each one with the end of the previous transcript as prompt.
+    size_t max_concurrent_requests = 4;
+    // Characters of the previous transcript passed as prompt
+    size_t prompt_characters = 400;
+  };
+
+  // Transcribes (or translates) audio files of any length.
+  // WAV files are split into chunks under the API file size limit, cut at silences or at fixed windows,
+  //  and sent as slices of the file without being copied. Other files are sent whole, when small enough.
+  // The chunks are transcribed in parallel lanes and stitched back into one verbose_json transcription,
+  //  with segment timestamps relative to the start of the file. See to_srt and to_vtt for subtitles.
+  class LongAudioTranscriber {
+   private:
+    http::HttpClient *http_client;
+    LongAudioOptions options;
+
+    // A piece of the file, and the part of the timeline it is responsible for
+    struct Chunk {
+      uint64_t first_frame = 0;
+      uint64_t end_frame = 0;
+      double owned_start = 0;
+      double owned_end = std::numeric_limits<double>::infinity();
+      std::optional<models::VerboseAudioResponse> transcription;
+    };
+
+   public:
+    explicit LongAudioTranscriber(http::HttpClient *http_client, LongAudioOptions options = {})
+        : http_client(http_client), options(std::move(options)) {}
+
+    Expected<models::VerboseAudioResponse> run(const std::string &path, const http::RequestOptions &request_options = {}) {
+      auto reader = std::make_shared<http::FileReader>(path);
+      auto info = read_wav_info(*reader);
+      if (!info) {
+        if (reader->size() > this->options.max_chunk_bytes) {
+          Error error;
+          error.kind = error_invalid_input;
+          error.path = this->endpoint();
+          error.detail = "only WAV files can be split, and the file is over the upload limit";
+          return error;
+        }
+        // sent whole: the API reads the format from the file name
+        auto body = std::make_shared<http::MultipartBody>();
+        body->add_file_range("file", reader, 0, reader->size(), std::filesystem::path(path).filename().string());
+        return this->transcribe(body, this->options.prompt, request_options);
+      }
+
+      auto chunks = this->plan(*reader, *info);
+
+      // the first failure stops the other lanes
+      auto cancellation = http::CancellationToken::create();
+      http::CancellationScope scope(request_options, [cancellation]() { cancellation->cancel(); });
+      auto chunk_options = request_options;
+      chunk_options.cancellation = cancellation;
+
+      std::mutex mutex;
+      std::optional<Error> failure;
+      const auto lanes = std::max<size_t>(1, std::min(this->options.max_concurrent_requests, chunks.size()));
+      std::vector<std::thread> workers;
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        workers.emplace_back([&, lane]() {
+          std::string previous;
+          for (auto index = lane * chunks.size() / lanes; index < (lane + 1) * chunks.size() / lanes; ++index) {
+            auto &chunk = chunks[index];
+            auto body = std::make_shared<http::MultipartBody>();
+            const auto size = (chunk.end_frame - chunk.first_frame) * info->block_align;
+            body->add_file_range("file", reader, info->data_offset + chunk.first_frame * info->block_align, size,
+                                 "chunk.wav", "audio/wav", wav::header(*info, size));
+
+            auto transcription = this->transcribe(body, this->prompt(previous), chunk_options);
+            if (!transcription) {
+              std::lock_guard<std::mutex> lock(mutex);
+              if (!failure) {
+                failure = std::move(transcription).error();
+                cancellation->cancel();
+              }
+              return;
+            }
+            previous = transcription->text;
+            chunk.transcription = std::move(transcription).value();
+          }
+        });
+      }
+      for (auto &worker : workers) {
+        worker.join();
+      }
+
+      if (failure) {
+        // the first failure, not the cancellations it caused on the other lanes
+        return std::move(*failure);
+      }
+      return this->stitch(chunks, *info);
+    }
+
+   private:
+    std::string endpoint() const {
+      return this->options.translate ? "/v1/audio/translations" : "/v1/audio/transcriptions";
+    }
+
+    // Cut the file into chunks of at most `chunk_seconds` and `max_chunk_bytes`, overlap included
+    std::vector<Chunk> plan(http::FileReader &reader, const WavInfo &info) const {
+      const uint64_t total = info.frames();
+      const auto overlap = static_cast<uint64_t>(std::max(0.0, this->options.overlap_seconds) * info.sample_rate);
+      const auto search = static_cast<uint64_t>(std::max(0.0, this->options.silence_search_seconds) * info.sample_rate);
+      const uint64_t header_size = 44;
+      auto max_frames = std::min(static_cast<uint64_t>(std::max(1.0, this->options.chunk_seconds) * info.sample_rate),
+                                 (std::max(this->options.max_chunk_bytes, header_size + info.block_align) - header_size) /
+                                     info.block_align);
+      // keep room for the overlap, and at least one second of new audio
+      max_frames = std::max<uint64_t>(max_frames > overlap ? max_frames - overlap : 0,
+                                      std::min<uint64_t>(info.sample_rate, max_frames));
+
+      std::vector<uint64_t> cuts = {0};
+      while (total - cuts.back() > max_frames) {
+        const auto target = cuts.back() + max_frames;
+        auto cut = target;
+        if (search > 0) {
+          cut = this->quietest(reader, info, std::max(cuts.back() + 1, target > search ? target - search : 0), target);
+        }
+        cuts.push_back(cut);
+      }
+      cuts.push_back(total);
+
+      std::vector<Chunk> chunks(cuts.size() - 1);
+      for (size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i].first_frame = cuts[i] > overlap ? cuts[i] - overlap : 0;
+        chunks[i].end_frame = cuts[i + 1];
+        chunks[i].owned_start = i == 0 ? 0 : static_cast<double>(cuts[i]) / info.sample_rate;
+        if (i + 1 < chunks.size()) {
+          chunks[i].owned_end = static_cast<double>(cuts[i + 1]) / info.sample_rate;
+        }
+      }
+      return chunks;
+    }
+
+    // Middle of the 50ms window with the least energy between frames `from` and `to`
+    static uint64_t quietest(http::FileReader &reader, const WavInfo &info, uint64_t from, uint64_t to) {
+      const uint64_t window = std::max<uint64_t>(1, info.sample_rate / 20);
+      if (to - from < window) {
+        return to;
+      }
+
+      std::vector<unsigned char> frames((to - from) * info.block_align);
+      const auto read = reader.read_at(info.data_offset + from * info.block_align,
+                                       reinterpret_cast<char *>(frames.data()), frames.size());
+      const auto available = read / info.block_align;
+
+      auto best = to;
+      auto best_energy = std::numeric_limits<double>::infinity();
+      for (uint64_t start = 0; start + window <= available; start += window) {
+        double energy = 0;
+        const auto *data = frames.data() + start * info.block_align;
+        for (size_t i = 0; i < window * info.channels; ++i) {
+          const auto value = wav::sample(info, data, i);
+          energy += value * value;
+        }
+        // ties go to the latest window: longer chunks
+        if (energy <= best_energy) {
+          best_energy = energy;
+          best = from + start + window / 2;
+        }
+      }
+      return best;
+    }
+
+    std::string prompt(const std::string &previous) const {
+      if (previous.empty()) {
+        return this->options.prompt;
+      }
+      auto tail = previous;
+      if (tail.size() > this->options.prompt_characters) {
+        tail = tail.substr(tail.size() - this->options.prompt_characters);
+        // start on a word
+        const auto space = tail.find(' ');
+        if (space != std::string::npos) {
+          tail = tail.substr(space + 1);
+        }
+      }
+      return this->options.prompt.empty() ? tail : this->options.prompt + " " + tail;
+    }
+
+    Expected<models::VerboseAudioResponse> transcribe(const std::shared_ptr<http::MultipartBody> &body,
+                                                      const std::string &prompt,
+                                                      const http::RequestOptions &request_options) {
+      body->add_field("model", this->options.model);
+      body->add_field("response_format", to_str(AUDIO_RESPONSE_FORMAT::verbose_json));
+      body->add_field("temperature", std::to_string(this->options.temperature));
+      if (!prompt.empty()) {
+        body->add_field("prompt", prompt);
+      }
+      if (!this->options.language.empty() && !this->options.translate) {
+        body->add_field("language", this->options.language);
+      }
+      return this->http_client->try_post<models::VerboseAudioResponse>(this->endpoint(), body, request_options);
+    }
+
+    // One transcription: the segments of every chunk moved to the file timeline,
+    //  each kept by the chunk owning its middle
+    static models::VerboseAudioResponse stitch(std::vector<Chunk> &chunks, const WavInfo &info) {
+      models::VerboseAudioResponse out;
+      out.duration = info.duration();
+      for (auto &chunk : chunks) {
+        auto &transcription = *chunk.transcription;
+        if (out.task.empty()) {
+          out.task = std::move(transcription.task);
+          out.language = std::move(transcription.language);
+        }
+
+        const auto offset = static_cast<double>(chunk.first_frame) / info.sample_rate;
+        for (auto &segment : transcription.segments) {
+          segment.start += offset;
+          segment.end += offset;
+          const auto middle = (segment.start + segment.end) / 2;
+          if (middle < chunk.owned_start || middle >= chunk.owned_end) {
+            continue;
+          }
+          segment.id = static_cast<int64_t>(out.segments.size());
+          out.text += segment.text;
+          out.segments.push_back(std::move(segment));
+        }
+      }
+
+      const auto start = out.text.find_first_not_of(' ');
+      out.text.erase(0, start == std::string::npos ? out.text.size() : start);
+      return out;
+    }
+  };
+}
@@ -3,6 +3,8 @@
 #include <tuple>
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <daw/json/daw_json_link.h>
 #include "commons.hpp"
 
@@ -10,6 +12,47 @@ namespace openai::models {
   struct AudioResponse {
     std::string text;
   };
+
+  // One timed piece of a verbose_json transcription
+  struct AudioSegment {
+    int64_t id;
+    // seconds from the start of the audio
+    double start;
+    double end;
+    std::string text;
+    double avg_logprob;
+    double no_speech_prob;
+  };
+
+  // AUDIO_RESPONSE_FORMAT::verbose_json
+  struct VerboseAudioResponse {
+    std::string task;
+    std::string language;
+    double duration;
+    std::string text;
+    std::vector<AudioSegment> segments;
+  };
+
+  // Views: the strings point into the response body instead of being copied, see Retained.
+  // JSON escape sequences are left as-is in the views.
+
+  struct AudioSegmentView {
+    int64_t id;
+    double start;
+    double end;
+    std::string_view text;
+    // NaN for srt and vtt
+    double avg_logprob;
+  };
+
+  // verbose_json, or the cues of srt and vtt subtitles (without task, language and text), see parse_transcript
+  struct VerboseAudioResponseView {
+    std::string_view task;
+    std::string_view language;
+    double duration;
+    std::string_view text;
+    std::vector<AudioSegmentView> segments;
+  };
 }
 
 namespace daw::json {
@@ -24,4 +67,91 @@ namespace daw::json {
       return std::forward_as_tuple(value.text);
     }
   };
+
+  template<>
+  struct json_data_contract<openai::models::AudioSegment> {
+    static constexpr char const mem_id[] = "id";
+    static constexpr char const mem_start[] = "start";
+    static constexpr char const mem_end[] = "end";
+    static constexpr char const mem_text[] = "text";
+    static constexpr char const mem_avg_logprob[] = "avg_logprob";
+    static constexpr char const mem_no_speech_prob[] = "no_speech_prob";
+    using type = json_member_list<
+        json_number<mem_id, int64_t>,
+        json_number<mem_start, double>,
+        json_number<mem_end, double>,
+        json_string<mem_text>,
+        json_number<mem_avg_logprob, double>,
+        json_number<mem_no_speech_prob, double>
+    >;
+
+    static inline auto to_json_data(openai::models::AudioSegment const &value) {
+      return std::forward_as_tuple(value.id, value.start, value.end, value.text, value.avg_logprob, value.no_speech_prob);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::VerboseAudioResponse> {
+    static constexpr char const mem_task[] = "task";
+    static constexpr char const mem_language[] = "language";
+    static constexpr char const mem_duration[] = "duration";
+    static constexpr char const mem_text[] = "text";
+    static constexpr char const mem_segments[] = "segments";
+    using type = json_member_list<
+        json_string<mem_task>,
+        json_string<mem_language>,
+        json_number<mem_duration, double>,
+        json_string<mem_text>,
+        json_array<mem_segments,
+                   json_class_no_name<openai::models::AudioSegment>,
+                   std::vector<openai::models::AudioSegment>>
+    >;
+
+    static inline auto to_json_data(openai::models::VerboseAudioResponse const &value) {
+      return std::forward_as_tuple(value.task, value.language, value.duration, value.text, value.segments);
+    }
+  };
+
+  // Views
+  template<>
+  struct json_data_contract<openai::models::AudioSegmentView> {
+    static constexpr char const mem_id[] = "id";
+    static constexpr char const mem_start[] = "start";
+    static constexpr char const mem_end[] = "end";
+    static constexpr char const mem_text[] = "text";
+    static constexpr char const mem_avg_logprob[] = "avg_logprob";
+    using type = json_member_list<
+        json_number<mem_id, int64_t>,
+        json_number<mem_start, double>,
+        json_number<mem_end, double>,
+        json_string_raw<mem_text, std::string_view>,
+        json_number<mem_avg_logprob, double>
+    >;
+
+    static inline auto to_json_data(openai::models::AudioSegmentView const &value) {
+      return std::forward_as_tuple(value.id, value.start, value.end, value.text, value.avg_logprob);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::VerboseAudioResponseView> {
+    static constexpr char const mem_task[] = "task";
+    static constexpr char const mem_language[] = "language";
+    static constexpr char const mem_duration[] = "duration";
+    static constexpr char const mem_text[] = "text";
+    static constexpr char const mem_segments[] = "segments";
+    using type = json_member_list<
+        json_string_raw<mem_task, std::string_view>,
+        json_string_raw<mem_language, std::string_view>,
+        json_number<mem_duration, double>,
+        json_string_raw<mem_text, std::string_view>,
+        json_array<mem_segments,
+                   json_class_no_name<openai::models::AudioSegmentView>,
+                   std::vector<openai::models::AudioSegmentView>>
+    >;
+
+    static inline auto to_json_data(openai::models::VerboseAudioResponseView const &value) {
+      return std::forward_as_tuple(value.task, value.language, value.duration, value.text, value.segments);
+    }
+  };
 }
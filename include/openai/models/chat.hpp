@@ -3,7 +3,10 @@
 #include <tuple>
 #include <optional>
 #include <cstdint>
+#include <functional>
+#include <map>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <daw/json/daw_json_link.h>
@@ -44,7 +47,7 @@ namespace openai {
       // minimum: 0
       // maximum: 2
       // default: 1
-      int64_t temperature;
+      double temperature;
       // An alternative to sampling with temperature, called nucleus sampling,
       //  where the model considers the results of the tokens with top_p probability mass.
       // So 0.1 means only the tokens comprising the top 10% probability mass are considered.
@@ -54,9 +57,11 @@ namespace openai {
       // minimum: 0
       // maximum: 1
       // default: 1
-      int64_t top_p;
+      double top_p;
       // How many chat completion choices to generate for each input message.
       int64_t n;
+      // Up to 4 sequences where the API will stop generating further tokens.
+      std::optional<StringList> stop;
       // WARNING: NOT SUPPORTED FOR NOW!!!
       //
       // If set, partial message deltas will be sent, like in ChatGPT.
@@ -70,15 +75,21 @@ namespace openai {
       // Positive values penalize new tokens based on whether they appear in the text so far,
       //  increasing the model's likelihood to talk about new topics.
       // see: https://platform.openai.com/docs/api-reference/parameter-details
-      int64_t presence_penalty;
+      double presence_penalty;
       // Number between -2.0 and 2.0.
       // Positive values penalize new tokens based on their existing frequency in the text so far,
       //  decreasing the model's likelihood to repeat the same line verbatim.
       // see: https://platform.openai.com/docs/api-reference/parameter-details
-      int64_t frequency_penalty;
+      double frequency_penalty;
       // A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse.
       // see: https://platform.openai.com/docs/guides/safety-best-practices/end-user-ids
       std::string user;
+      // Modify the likelihood of specified tokens appearing in the completion.
+      // Maps tokens (specified by their token ID in the tokenizer) to a bias value from -100 to 100.
+      std::optional<std::map<std::string, double>> logit_bias;
+      // If specified, the system will make a best effort to sample deterministically:
+      //  repeated requests with the same seed and parameters should return the same result.
+      std::optional<int64_t> seed;
     };
 
     // Response Models
@@ -111,6 +122,17 @@ namespace openai {
         }
         return this->choices[0].message.content;
       }
+
+      // The contents of all the choices by index, pointing into this response
+      std::vector<std::string_view> texts() const {
+        std::vector<std::string_view> texts(this->choices.size());
+        for (size_t i = 0; i < this->choices.size(); ++i) {
+          const auto index = this->choices[i].index;
+          const auto slot = index >= 0 && static_cast<size_t>(index) < texts.size() ? static_cast<size_t>(index) : i;
+          texts[slot] = this->choices[i].message.content;
+        }
+        return texts;
+      }
     };
   }
 }
@@ -139,37 +161,49 @@ namespace daw::json {
     static constexpr char const mem_temperature[] = "temperature";
     static constexpr char const mem_top_p[] = "top_p";
     static constexpr char const mem_n[] = "n";
+    static constexpr char const mem_stop[] = "stop";
     static constexpr char const mem_stream[] = "stream";
     static constexpr char const mem_max_tokens[] = "max_tokens";
     static constexpr char const mem_presence_penalty[] = "presence_penalty";
     static constexpr char const mem_frequency_penalty[] = "frequency_penalty";
     static constexpr char const mem_user[] = "user";
+    static constexpr char const mem_logit_bias[] = "logit_bias";
+    static constexpr char const mem_seed[] = "seed";
     using type = json_member_list<
         json_string<mem_model>,
         json_array<mem_messages,
                    json_class_no_name<openai::models::ChatCompletionRequestMessage>,
                    std::vector<openai::models::ChatCompletionRequestMessage>>,
-        json_number<mem_temperature, int64_t>,
-        json_number<mem_top_p, int64_t>,
-        json_number<mem_n, int64_t>,
-        json_bool<mem_stream>,
+        json_number_null<mem_temperature, std::optional<double>>,
+        json_number_null<mem_top_p, std::optional<double>>,
+        json_number_null<mem_n, std::optional<int64_t>>,
+        json_variant_null<mem_stop, std::optional<openai::models::StringList>>,
+        json_bool_null<mem_stream, std::optional<bool>>,
         json_number_null<mem_max_tokens, int64_t>,
-        json_number<mem_presence_penalty, int64_t>,
-        json_number<mem_frequency_penalty, int64_t>,
-        json_string<mem_user>
+        json_number_null<mem_presence_penalty, std::optional<double>>,
+        json_number_null<mem_frequency_penalty, std::optional<double>>,
+        json_string_null<mem_user, std::optional<std::string>>,
+        json_key_value_null<mem_logit_bias, std::optional<std::map<std::string, double>>, double>,
+        json_number_null<mem_seed, std::optional<int64_t>>
     >;
 
+    // the members holding the API default are left out, see unless_default
     static inline auto to_json_data(openai::models::ChatCompletionRequest const &value) {
-      return std::forward_as_tuple(value.model,
-                                   value.messages,
-                                   value.temperature,
-                                   value.top_p,
-                                   value.n,
-                                   value.stream,
-                                   value.max_tokens,
-                                   value.presence_penalty,
-                                   value.frequency_penalty,
-                                   value.user);
+      using openai::models::unless_default;
+      namespace defaults = openai::models::defaults;
+      return std::make_tuple(std::cref(value.model),
+                             std::cref(value.messages),
+                             unless_default(value.temperature, defaults::temperature),
+                             unless_default(value.top_p, defaults::top_p),
+                             unless_default(value.n, defaults::n),
+                             std::cref(value.stop),
+                             unless_default(value.stream, defaults::stream),
+                             std::cref(value.max_tokens),
+                             unless_default(value.presence_penalty, defaults::presence_penalty),
+                             unless_default(value.frequency_penalty, defaults::frequency_penalty),
+                             unless_default(value.user, defaults::user),
+                             std::cref(value.logit_bias),
+                             std::cref(value.seed));
     }
   };
 
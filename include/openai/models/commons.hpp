@@ -1,15 +1,81 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
 #include <daw/json/daw_json_link.h>
 
 // Models
 namespace openai::models {
+  // A string or an array of strings, eg: the prompt(s) of a completion
+  using StringList = std::variant<std::string, std::vector<std::string>>;
+
   struct Usage {
     int64_t prompt_tokens;
     int64_t completion_tokens;
     int64_t total_tokens;
   };
+
+  // The API defaults of the request members, in one place for the request contracts
+  //  which leave them out of the bodies (see unless_default) and the get_default_*_request helpers
+  namespace defaults {
+    inline constexpr int64_t n = 1;
+    inline constexpr double temperature = 1;
+    inline constexpr double top_p = 1;
+    inline constexpr double presence_penalty = 0;
+    inline constexpr double frequency_penalty = 0;
+    inline constexpr bool stream = false;
+    inline constexpr std::string_view user = "";
+    // completions
+    inline constexpr std::string_view suffix = "";
+    inline constexpr int64_t max_tokens = 16;
+    inline constexpr bool echo = false;
+    inline constexpr int64_t best_of = 1;
+    // image generations
+    inline constexpr std::string_view image_size = "1024x1024";
+    inline constexpr std::string_view image_response_format = "url";
+  }
+
+  // The member, or nothing when it holds the API default.
+  // Serialized through a json_*_null member of the contract, the default is left out of the request body:
+  //  the API applies it anyway, so the request keeps its meaning with fewer bytes.
+  // The comparison runs for every body serialized.
+  template<typename T, typename Default>
+  inline std::optional<T> unless_default(const T &value, const Default &default_value) {
+    if (value == default_value) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  // Strings are not copied: a pointer to the member, null when it holds the API default
+  template<typename Default>
+  inline const std::string *unless_default(const std::string &value, const Default &default_value) {
+    if (value == default_value) {
+      return nullptr;
+    }
+    return &value;
+  }
+
+  // A response parsed into a view model, whose std::string_view members point into `body`.
+  // Not copyable or movable: keep it behind the returned pointer.
+  template<typename View>
+  struct Retained {
+    const std::string body;
+    View value;
+
+    explicit Retained(std::string body) : body(std::move(body)) {}
+    Retained(const Retained &) = delete;
+    Retained &operator=(const Retained &) = delete;
+
+    const View *operator->() const { return &this->value; }
+    const View &operator*() const { return this->value; }
+  };
 }
 
 // JSON defs
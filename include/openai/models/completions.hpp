@@ -1,8 +1,13 @@
 #pragma once
 
+#include <functional>
+#include <map>
+#include <optional>
 #include <string>
+#include <vector>
 #include <daw/json/daw_json_link.h>
 #include "commons.hpp"
+#include "logprobs.hpp"
 
 namespace openai::models {
   // Request
@@ -14,12 +19,13 @@ namespace openai::models {
     // see: https://platform.openai.com/docs/api-reference/models/list
     // see: https://platform.openai.com/docs/models/overview
     std::string model;
-    // WARNING: Only support `string` for now
+    // WARNING: Only support `string` and array of strings for now
     // The prompt(s) to generate completions for, encoded as a string, array of strings, array of tokens, or array of token arrays.
+    // With an array of prompts, the choices of prompt `i` have the indexes [i * n, (i + 1) * n).
     //
     // Note that <|endoftext|> is the document separator that the model sees during training,
     //  so if a prompt is not specified the model will generate as if from the beginning of a new document.
-    std::string prompt;
+    StringList prompt;
     // The suffix that comes after a completion of inserted text.
     std::string suffix;
     // The maximum number of tokens to generate in the completion.
@@ -36,7 +42,7 @@ namespace openai::models {
     // minimum: 0
     // maximum: 2
     // default: 1
-    int64_t temperature;
+    double temperature;
     // An alternative to sampling with temperature, called nucleus sampling,
     //  where the model considers the results of the tokens with top_p probability mass.
     // So 0.1 means only the tokens comprising the top 10% probability mass are considered.
@@ -46,23 +52,28 @@ namespace openai::models {
     // minimum: 0
     // maximum: 1
     // default: 1
-    int64_t top_p;
+    double top_p;
     // How many chat completion choices to generate for each input message.
     int64_t n;
+    // Include the log probabilities on the `logprobs` most likely tokens, as well the chosen tokens.
+    // For example, if logprobs is 5, the API will return a list of the 5 most likely tokens.
+    // The API will always return the logprob of the sampled token, so there may be up to logprobs+1 elements in the response.
+    //  maximum: 5
+    std::optional<int64_t> logprobs;
     // Echo back the prompt in addition to the completion
     bool echo;
-    // 1 sequence where the API will stop generating further tokens. The returned text will not contain the stop sequence.
-    std::string stop;
+    // Up to 4 sequences where the API will stop generating further tokens. The returned text will not contain the stop sequence.
+    std::optional<StringList> stop;
     // Number between -2.0 and 2.0.
     // Positive values penalize new tokens based on whether they appear in the text so far,
     //  increasing the model's likelihood to talk about new topics.
     // see: https://platform.openai.com/docs/api-reference/parameter-details
-    int64_t presence_penalty;
+    double presence_penalty;
     // Number between -2.0 and 2.0.
     // Positive values penalize new tokens based on their existing frequency in the text so far,
     //  decreasing the model's likelihood to repeat the same line verbatim.
     // see: https://platform.openai.com/docs/api-reference/parameter-details
-    int64_t frequency_penalty;
+    double frequency_penalty;
     // Generates best_of completions server-side and returns the "best" (the one with the highest log probability per token).
     // Results cannot be streamed.
     // When used with n, best_of controls the number of candidate completions and n specifies how many to return
@@ -77,6 +88,14 @@ namespace openai::models {
     // A unique identifier representing your end-user, which can help OpenAI to monitor and detect abuse.
     // see: https://platform.openai.com/docs/guides/safety-best-practices/end-user-ids
     std::string user;
+    // Modify the likelihood of specified tokens appearing in the completion.
+    // Maps tokens (specified by their token ID in the GPT tokenizer) to a bias value from -100 to 100.
+    // Values between -1 and 1 should decrease or increase likelihood of selection;
+    //  values like -100 or 100 should result in a ban or exclusive selection of the relevant token.
+    std::optional<std::map<std::string, double>> logit_bias;
+    // If specified, the system will make a best effort to sample deterministically:
+    //  repeated requests with the same seed and parameters should return the same result.
+    std::optional<int64_t> seed;
   };
 
   // Response
@@ -84,6 +103,8 @@ namespace openai::models {
   struct CompletionsResponseChoices {
     std::string text;
     int64_t index;
+    // set when the request asked for logprobs
+    std::optional<LogProbs> logprobs;
     std::string finish_reason;
   };
 
@@ -108,42 +129,54 @@ namespace daw::json {
     static constexpr char const mem_temperature[] = "temperature";
     static constexpr char const mem_top_p[] = "top_p";
     static constexpr char const mem_n[] = "n";
+    static constexpr char const mem_logprobs[] = "logprobs";
     static constexpr char const mem_echo[] = "echo";
     static constexpr char const mem_stop[] = "stop";
     static constexpr char const mem_presence_penalty[] = "presence_penalty";
     static constexpr char const mem_frequency_penalty[] = "frequency_penalty";
     static constexpr char const mem_best_of[] = "best_of";
     static constexpr char const mem_user[] = "user";
+    static constexpr char const mem_logit_bias[] = "logit_bias";
+    static constexpr char const mem_seed[] = "seed";
     using type = json_member_list<
         json_string<mem_model>,
-        json_string<mem_prompt>,
-        json_string<mem_suffix>,
-        json_number<mem_max_tokens, int64_t>,
-        json_number<mem_temperature, int64_t>,
-        json_number<mem_top_p, int64_t>,
-        json_number<mem_n, int64_t>,
-        json_bool<mem_echo>,
-        json_string<mem_stop>,
-        json_number<mem_presence_penalty, int64_t>,
-        json_number<mem_frequency_penalty, int64_t>,
-        json_number<mem_best_of, int64_t>,
-        json_string<mem_user>
+        json_variant<mem_prompt, openai::models::StringList>,
+        json_string_null<mem_suffix, std::optional<std::string>>,
+        json_number_null<mem_max_tokens, std::optional<int64_t>>,
+        json_number_null<mem_temperature, std::optional<double>>,
+        json_number_null<mem_top_p, std::optional<double>>,
+        json_number_null<mem_n, std::optional<int64_t>>,
+        json_number_null<mem_logprobs, std::optional<int64_t>>,
+        json_bool_null<mem_echo, std::optional<bool>>,
+        json_variant_null<mem_stop, std::optional<openai::models::StringList>>,
+        json_number_null<mem_presence_penalty, std::optional<double>>,
+        json_number_null<mem_frequency_penalty, std::optional<double>>,
+        json_number_null<mem_best_of, std::optional<int64_t>>,
+        json_string_null<mem_user, std::optional<std::string>>,
+        json_key_value_null<mem_logit_bias, std::optional<std::map<std::string, double>>, double>,
+        json_number_null<mem_seed, std::optional<int64_t>>
     >;
 
+    // the members holding the API default are left out, see unless_default
     static inline auto to_json_data(openai::models::CompletionsRequest const &value) {
-      return std::forward_as_tuple(value.model,
-                                   value.prompt,
-                                   value.suffix,
-                                   value.max_tokens,
-                                   value.temperature,
-                                   value.top_p,
-                                   value.n,
-                                   value.echo,
-                                   value.stop,
-                                   value.presence_penalty,
-                                   value.frequency_penalty,
-                                   value.best_of,
-                                   value.user);
+      using openai::models::unless_default;
+      namespace defaults = openai::models::defaults;
+      return std::make_tuple(std::cref(value.model),
+                             std::cref(value.prompt),
+                             unless_default(value.suffix, defaults::suffix),
+                             unless_default(value.max_tokens, defaults::max_tokens),
+                             unless_default(value.temperature, defaults::temperature),
+                             unless_default(value.top_p, defaults::top_p),
+                             unless_default(value.n, defaults::n),
+                             std::cref(value.logprobs),
+                             unless_default(value.echo, defaults::echo),
+                             std::cref(value.stop),
+                             unless_default(value.presence_penalty, defaults::presence_penalty),
+                             unless_default(value.frequency_penalty, defaults::frequency_penalty),
+                             unless_default(value.best_of, defaults::best_of),
+                             unless_default(value.user, defaults::user),
+                             std::cref(value.logit_bias),
+                             std::cref(value.seed));
     }
   };
 
@@ -151,15 +184,20 @@ namespace daw::json {
   struct json_data_contract<openai::models::CompletionsResponseChoices> {
     static constexpr char const mem_text[] = "text";
     static constexpr char const mem_index[] = "index";
+    static constexpr char const mem_logprobs[] = "logprobs";
     static constexpr char const mem_finish_reason[] = "finish_reason";
     using type = json_member_list<
         json_string<mem_text>,
         json_number<mem_index, int64_t>,
+        json_raw_null<mem_logprobs,
+                      std::optional<openai::models::LogProbs>,
+                      openai::models::LogProbsFromJson,
+                      openai::models::LogProbsToJson>,
         json_string<mem_finish_reason>
     >;
 
     static inline auto to_json_data(openai::models::CompletionsResponseChoices const &value) {
-      return std::forward_as_tuple(value.text, value.index, value.finish_reason);
+      return std::forward_as_tuple(value.text, value.index, value.logprobs, value.finish_reason);
     }
   };
 
@@ -193,16 +231,16 @@ namespace openai::models {
     CompletionsRequest req;
     req.model = "text-davinci-003";
     req.prompt = "";
-    req.suffix = "";
-    req.max_tokens = 16;
-    req.temperature = 1;
-    req.top_p = 1;
-    req.n = 1;
-    req.echo = false;
-    req.presence_penalty = 0;
-    req.frequency_penalty = 0;
-    req.best_of = 1;
-    req.user = "";
+    req.suffix = defaults::suffix;
+    req.max_tokens = defaults::max_tokens;
+    req.temperature = defaults::temperature;
+    req.top_p = defaults::top_p;
+    req.n = defaults::n;
+    req.echo = defaults::echo;
+    req.presence_penalty = defaults::presence_penalty;
+    req.frequency_penalty = defaults::frequency_penalty;
+    req.best_of = defaults::best_of;
+    req.user = defaults::user;
 
     return req;
   }
@@ -2,6 +2,8 @@
 
 #include <tuple>
 #include <cstdint>
+#include <functional>
+#include <optional>
 #include <string>
 #include <daw/json/daw_json_link.h>
 #include "commons.hpp"
@@ -27,13 +29,13 @@ namespace openai::models {
     // minimum: 0
     // maximum: 2
     // default: 1
-    int64_t temperature;
+    double temperature;
     // An alternative to sampling with temperature, called nucleus sampling, where the model considers the results of the tokens with top_p probability mass. So 0.1 means only the tokens comprising the top 10% probability mass are considered.
     // We generally recommend altering this or temperature but not both.
     // minimum: 0
     // maximum: 1
     // default: 1
-    int64_t top_p;
+    double top_p;
   };
 
   // Response
@@ -66,18 +68,21 @@ namespace daw::json {
         json_string<mem_model>,
         json_string<mem_input>,
         json_string<mem_instruction>,
-        json_number<mem_n, int64_t>,
-        json_number<mem_temperature, int64_t>,
-        json_number<mem_top_p, int64_t>
+        json_number_null<mem_n, std::optional<int64_t>>,
+        json_number_null<mem_temperature, std::optional<double>>,
+        json_number_null<mem_top_p, std::optional<double>>
     >;
 
+    // the members holding the API default are left out, see unless_default
     static inline auto to_json_data(openai::models::EditsRequest const &value) {
-      return std::forward_as_tuple(value.model,
-                                   value.input,
-                                   value.instruction,
-                                   value.n,
-                                   value.temperature,
-                                   value.top_p);
+      using openai::models::unless_default;
+      namespace defaults = openai::models::defaults;
+      return std::make_tuple(std::cref(value.model),
+                             std::cref(value.input),
+                             std::cref(value.instruction),
+                             unless_default(value.n, defaults::n),
+                             unless_default(value.temperature, defaults::temperature),
+                             unless_default(value.top_p, defaults::top_p));
     }
   };
 
@@ -122,9 +127,9 @@ namespace openai::models {
   inline EditsRequest get_default_edits_request() {
     EditsRequest req;
     req.model = "text-davinci-edit-001";
-    req.n = 1;
-    req.temperature = 1;
-    req.top_p = 1;
+    req.n = defaults::n;
+    req.temperature = defaults::temperature;
+    req.top_p = defaults::top_p;
 
     return req;
   }
@@ -3,8 +3,11 @@
 #pragma once
 
 #include <tuple>
+#include <functional>
+#include <optional>
 #include <string>
 #include <daw/json/daw_json_link.h>
+#include "commons.hpp"
 
 namespace openai::models {
   // Request
@@ -53,11 +56,14 @@ namespace daw::json {
     static constexpr char const mem_input[] = "input";
     static constexpr char const mem_user[] = "user";
     using type = json_member_list<
-        json_string<mem_model>, json_string<mem_input>, json_string<mem_user>
+        json_string<mem_model>, json_string<mem_input>, json_string_null<mem_user, std::optional<std::string>>
     >;
 
+    // an empty user is left out, see unless_default
     static inline auto to_json_data(openai::models::EmbeddingRequest const &value) {
-      return std::forward_as_tuple(value.model, value.input, value.user);
+      return std::make_tuple(std::cref(value.model),
+                             std::cref(value.input),
+                             openai::models::unless_default(value.user, openai::models::defaults::user));
     }
   };
 
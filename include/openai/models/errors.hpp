@@ -0,0 +1,57 @@
+#pragma once
+
+#include <tuple>
+#include <optional>
+#include <string>
+#include <daw/json/daw_json_link.h>
+
+namespace openai::models {
+  // Body of the non-200 responses
+  // see: https://platform.openai.com/docs/guides/error-codes/api-errors
+  struct APIErrorDetails {
+    std::string message;
+    // Eg: invalid_request_error, server_error, insufficient_quota
+    std::optional<std::string> type;
+    // The request parameter at fault, if any
+    std::optional<std::string> param;
+    // Eg: rate_limit_exceeded, model_not_found
+    std::optional<std::string> code;
+  };
+
+  struct APIErrorResponse {
+    APIErrorDetails error;
+  };
+}
+
+// JSON defs
+namespace daw::json {
+  template<>
+  struct json_data_contract<openai::models::APIErrorDetails> {
+    static constexpr char const mem_message[] = "message";
+    static constexpr char const mem_type[] = "type";
+    static constexpr char const mem_param[] = "param";
+    static constexpr char const mem_code[] = "code";
+    using type = json_member_list<
+        json_string<mem_message>,
+        json_string_null<mem_type>,
+        json_string_null<mem_param>,
+        json_string_null<mem_code>
+    >;
+
+    static inline auto to_json_data(openai::models::APIErrorDetails const &value) {
+      return std::forward_as_tuple(value.message, value.type, value.param, value.code);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::APIErrorResponse> {
+    static constexpr char const mem_error[] = "error";
+    using type = json_member_list<
+        json_class<mem_error, openai::models::APIErrorDetails>
+    >;
+
+    static inline auto to_json_data(openai::models::APIErrorResponse const &value) {
+      return std::forward_as_tuple(value.error);
+    }
+  };
+}
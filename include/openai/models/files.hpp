@@ -4,6 +4,7 @@
 
 #include <tuple>
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 #include <daw/json/daw_json_link.h>
@@ -18,6 +19,8 @@ namespace openai {
       std::string filename;
       std::string purpose;
       std::string status;
+      // why the file could not be processed, when its status is "error"
+      std::optional<std::string> status_details;
     };
 
     struct ListFilesResponse {
@@ -43,6 +46,7 @@ namespace daw::json {
     static constexpr char const mem_filename[] = "filename";
     static constexpr char const mem_purpose[] = "purpose";
     static constexpr char const mem_status[] = "status";
+    static constexpr char const mem_status_details[] = "status_details";
     using type = json_member_list<
         json_string<mem_id>,
         json_string<mem_object>,
@@ -50,7 +54,8 @@ namespace daw::json {
         json_number<mem_created_at, int64_t>,
         json_string<mem_filename>,
         json_string<mem_purpose>,
-        json_string<mem_status>
+        json_string<mem_status>,
+        json_string_null<mem_status_details>
     >;
 
     static inline auto to_json_data(openai::models::OpenAIFile const &value) {
@@ -60,7 +65,8 @@ namespace daw::json {
                                    value.created_at,
                                    value.filename,
                                    value.purpose,
-                                   value.status
+                                   value.status,
+                                   value.status_details
       );
     }
   };
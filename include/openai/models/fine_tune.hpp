@@ -4,16 +4,20 @@
 
 #include <tuple>
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <daw/json/daw_json_link.h>
 #include "files.hpp"
 
 namespace openai::models {
+  // Training parameters of a job. Unset while the job is pending
   struct HyperParams {
-  };
-
-  struct FineTuneStatusDetails {
+    std::optional<int64_t> batch_size;
+    std::optional<double> learning_rate_multiplier;
+    std::optional<int64_t> n_epochs;
+    std::optional<double> prompt_loss_weight;
   };
 
   struct FineTuneEvent {
@@ -29,14 +33,16 @@ namespace openai::models {
     int64_t created_at;
     int64_t updated_at;
     std::string model;
-    std::string fine_tuned_model;
+    // set once the job succeeded
+    std::optional<std::string> fine_tuned_model;
     std::string organization_id;
     std::string status;
     HyperParams hyperparams;
     std::vector<openai::models::OpenAIFile> training_files;
     std::vector<openai::models::OpenAIFile> validation_files;
     std::vector<openai::models::OpenAIFile> result_files;
-    std::vector<FineTuneEvent> events;
+    // only sent when getting or creating a single job
+    std::optional<std::vector<FineTuneEvent>> events;
   };
 
   struct ListFineTune {
@@ -105,27 +111,58 @@ namespace openai::models {
     std::string object;
     std::vector<FineTuneEvent> data;
   };
-}
 
-namespace daw::json {
-  template<>
-  struct json_data_contract<openai::models::HyperParams> {
-    using type = json_member_list<
-    >;
+  // Views: the strings point into the response body instead of being copied, see Retained.
+  // JSON escape sequences are left as-is in the views.
 
-    static inline auto to_json_data(openai::models::HyperParams const &value) {
-      return std::forward_as_tuple();
-    }
+  struct FineTuneView {
+    std::string_view id;
+    std::string_view object;
+    int64_t created_at;
+    int64_t updated_at;
+    std::string_view model;
+    std::optional<std::string_view> fine_tuned_model;
+    std::string_view organization_id;
+    std::string_view status;
+  };
+
+  struct ListFineTuneView {
+    std::string_view object;
+    std::vector<FineTuneView> data;
+  };
+
+  struct FineTuneEventView {
+    std::string_view object;
+    int64_t created_at;
+    std::string_view level;
+    std::string_view message;
+  };
+
+  struct ListFineTuneEventsView {
+    std::string_view object;
+    std::vector<FineTuneEventView> data;
   };
 }
+
 namespace daw::json {
   template<>
-  struct json_data_contract<openai::models::FineTuneStatusDetails> {
+  struct json_data_contract<openai::models::HyperParams> {
+    static constexpr char const mem_batch_size[] = "batch_size";
+    static constexpr char const mem_learning_rate_multiplier[] = "learning_rate_multiplier";
+    static constexpr char const mem_n_epochs[] = "n_epochs";
+    static constexpr char const mem_prompt_loss_weight[] = "prompt_loss_weight";
     using type = json_member_list<
+        json_number_null<mem_batch_size, std::optional<int64_t>>,
+        json_number_null<mem_learning_rate_multiplier, std::optional<double>>,
+        json_number_null<mem_n_epochs, std::optional<int64_t>>,
+        json_number_null<mem_prompt_loss_weight, std::optional<double>>
     >;
 
-    static inline auto to_json_data(openai::models::FineTuneStatusDetails const &value) {
-      return std::forward_as_tuple();
+    static inline auto to_json_data(openai::models::HyperParams const &value) {
+      return std::forward_as_tuple(value.batch_size,
+                                   value.learning_rate_multiplier,
+                                   value.n_epochs,
+                                   value.prompt_loss_weight);
     }
   };
 }
@@ -167,7 +204,7 @@ namespace daw::json {
         json_number<mem_created_at, int64_t>,
         json_number<mem_updated_at, int64_t>,
         json_string<mem_model>,
-        json_string<mem_fine_tuned_model>,
+        json_string_null<mem_fine_tuned_model>,
         json_string<mem_organization_id>,
         json_string<mem_status>,
         json_class<mem_hyperparams, openai::models::HyperParams>,
@@ -180,9 +217,9 @@ namespace daw::json {
         json_array<mem_result_files,
                    json_class_no_name<openai::models::OpenAIFile>,
                    std::vector<openai::models::OpenAIFile>>,
-        json_array<mem_events,
-                   json_class_no_name<openai::models::FineTuneEvent>,
-                   std::vector<openai::models::FineTuneEvent>>
+        json_array_null<mem_events,
+                        json_class_no_name<openai::models::FineTuneEvent>,
+                        std::optional<std::vector<openai::models::FineTuneEvent>>>
     >;
 
     static inline auto to_json_data(openai::models::FineTune const &value) {
@@ -278,4 +315,88 @@ namespace daw::json {
       return std::forward_as_tuple(value.object, value.data);
     }
   };
+
+  // Views
+  template<>
+  struct json_data_contract<openai::models::FineTuneView> {
+    static constexpr char const mem_id[] = "id";
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_created_at[] = "created_at";
+    static constexpr char const mem_updated_at[] = "updated_at";
+    static constexpr char const mem_model[] = "model";
+    static constexpr char const mem_fine_tuned_model[] = "fine_tuned_model";
+    static constexpr char const mem_organization_id[] = "organization_id";
+    static constexpr char const mem_status[] = "status";
+    using type = json_member_list<
+        json_string_raw<mem_id, std::string_view>,
+        json_string_raw<mem_object, std::string_view>,
+        json_number<mem_created_at, int64_t>,
+        json_number<mem_updated_at, int64_t>,
+        json_string_raw<mem_model, std::string_view>,
+        json_string_raw_null<mem_fine_tuned_model, std::optional<std::string_view>>,
+        json_string_raw<mem_organization_id, std::string_view>,
+        json_string_raw<mem_status, std::string_view>
+    >;
+
+    static inline auto to_json_data(openai::models::FineTuneView const &value) {
+      return std::forward_as_tuple(value.id,
+                                   value.object,
+                                   value.created_at,
+                                   value.updated_at,
+                                   value.model,
+                                   value.fine_tuned_model,
+                                   value.organization_id,
+                                   value.status);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::ListFineTuneView> {
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_data[] = "data";
+    using type = json_member_list<
+        json_string_raw<mem_object, std::string_view>,
+        json_array<mem_data,
+                   json_class_no_name<openai::models::FineTuneView>,
+                   std::vector<openai::models::FineTuneView>>
+    >;
+
+    static inline auto to_json_data(openai::models::ListFineTuneView const &value) {
+      return std::forward_as_tuple(value.object, value.data);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::FineTuneEventView> {
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_created_at[] = "created_at";
+    static constexpr char const mem_level[] = "level";
+    static constexpr char const mem_message[] = "message";
+    using type = json_member_list<
+        json_string_raw<mem_object, std::string_view>,
+        json_number<mem_created_at, int64_t>,
+        json_string_raw<mem_level, std::string_view>,
+        json_string_raw<mem_message, std::string_view>
+    >;
+
+    static inline auto to_json_data(openai::models::FineTuneEventView const &value) {
+      return std::forward_as_tuple(value.object, value.created_at, value.level, value.message);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::ListFineTuneEventsView> {
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_data[] = "data";
+    using type = json_member_list<
+        json_string_raw<mem_object, std::string_view>,
+        json_array<mem_data,
+                   json_class_no_name<openai::models::FineTuneEventView>,
+                   std::vector<openai::models::FineTuneEventView>>
+    >;
+
+    static inline auto to_json_data(openai::models::ListFineTuneEventsView const &value) {
+      return std::forward_as_tuple(value.object, value.data);
+    }
+  };
 }
@@ -4,9 +4,13 @@
 
 #include <tuple>
 #include <cstdint>
+#include <functional>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <daw/json/daw_json_link.h>
+#include "commons.hpp"
 
 namespace openai {
   namespace models {
@@ -35,6 +39,18 @@ namespace openai {
       std::vector<ImagesResponseElement> data;
     };
 
+    // Views: b64_json points into the response body instead of being copied, see Retained.
+    // Decode it with openai::base64_decode.
+    struct ImagesResponseElementView {
+      std::optional<std::string_view> url;
+      std::optional<std::string_view> b64_json;
+    };
+
+    struct ImagesResponseView {
+      int64_t created;
+      std::vector<ImagesResponseElementView> data;
+    };
+
   }
 }
 
@@ -50,14 +66,21 @@ namespace daw::json {
     static constexpr char const mem_user[] = "user";
     using type = json_member_list<
         json_string<mem_prompt>,
-        json_number<mem_n, int64_t>,
-        json_string<mem_size>,
-        json_string<mem_response_format>,
-        json_string<mem_user>
+        json_number_null<mem_n, std::optional<int64_t>>,
+        json_string_null<mem_size, std::optional<std::string>>,
+        json_string_null<mem_response_format, std::optional<std::string>>,
+        json_string_null<mem_user, std::optional<std::string>>
     >;
 
+    // the members holding the API default are left out, see unless_default
     static inline auto to_json_data(openai::models::ImagesGenerationsRequest const &value) {
-      return std::forward_as_tuple(value.prompt, value.n, value.size, value.response_format, value.user);
+      using openai::models::unless_default;
+      namespace defaults = openai::models::defaults;
+      return std::make_tuple(std::cref(value.prompt),
+                             unless_default(value.n, defaults::n),
+                             unless_default(value.size, defaults::image_size),
+                             unless_default(value.response_format, defaults::image_response_format),
+                             unless_default(value.user, defaults::user));
     }
   };
 
@@ -92,4 +115,35 @@ namespace daw::json {
       return std::forward_as_tuple(value.created, value.data);
     }
   };
-}
\ No newline at end of file
+
+  // Views
+  template<>
+  struct json_data_contract<openai::models::ImagesResponseElementView> {
+    static constexpr char const mem_url[] = "url";
+    static constexpr char const mem_b64_json[] = "b64_json";
+    using type = json_member_list<
+        json_string_raw_null<mem_url, std::optional<std::string_view>>,
+        json_string_raw_null<mem_b64_json, std::optional<std::string_view>>
+    >;
+
+    static inline auto to_json_data(openai::models::ImagesResponseElementView const &value) {
+      return std::forward_as_tuple(value.url, value.b64_json);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::ImagesResponseView> {
+    static constexpr char const mem_created[] = "created";
+    static constexpr char const mem_data[] = "data";
+    using type = json_member_list<
+        json_number<mem_created, int64_t>,
+        json_array<mem_data,
+                   json_class_no_name<openai::models::ImagesResponseElementView>,
+                   std::vector<openai::models::ImagesResponseElementView>>
+    >;
+
+    static inline auto to_json_data(openai::models::ImagesResponseView const &value) {
+      return std::forward_as_tuple(value.created, value.data);
+    }
+  };
+}
@@ -0,0 +1,553 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace openai::models {
+  // Token level output of a completion, see CompletionsRequest::logprobs.
+  // Stored as arrays indexed by token rather than one object per token:
+  //  the token strings are slices of one `arena` string, and the top alternatives of token `i`
+  //  are the entries [top_offsets[i], top_offsets[i + 1]) of the top_* arrays.
+  struct LogProbs {
+    struct Span {
+      uint32_t offset;
+      uint32_t size;
+    };
+
+    std::string arena;
+    std::vector<Span> tokens;
+    // NaN when the API sent null: the first token of an echoed prompt
+    std::vector<float> token_logprobs;
+    // offset of every token in the text of the choice
+    std::vector<int64_t> text_offsets;
+    // size() + 1 entries
+    std::vector<uint32_t> top_offsets;
+    std::vector<Span> top_tokens;
+    std::vector<float> top_logprobs;
+
+    size_t size() const { return this->tokens.size(); }
+
+    std::string_view token(size_t i) const { return this->slice(this->tokens[i]); }
+
+    // Number of alternatives of token `i`, the `logprobs` of the request at most
+    size_t top_count(size_t i) const { return this->top_offsets[i + 1] - this->top_offsets[i]; }
+
+    std::string_view top_token(size_t i, size_t k) const {
+      return this->slice(this->top_tokens[this->top_offsets[i] + k]);
+    }
+
+    float top_logprob(size_t i, size_t k) const { return this->top_logprobs[this->top_offsets[i] + k]; }
+
+    // Log probability of the whole text, the unknown token logprobs are skipped
+    double total_logprob() const {
+      double total = 0;
+      for (const auto logprob : this->token_logprobs) {
+        if (!std::isnan(logprob)) {
+          total += logprob;
+        }
+      }
+      return total;
+    }
+
+   private:
+    std::string_view slice(Span span) const { return {this->arena.data() + span.offset, span.size}; }
+  };
+
+  namespace logprobs {
+    // A hand written scanner for the `logprobs` object of a completion choice:
+    //  it fills LogProbs directly instead of building one string and one map per token.
+    class Scanner {
+     private:
+      std::string_view json;
+      size_t position = 0;
+      LogProbs &out;
+
+     public:
+      Scanner(std::string_view json, LogProbs &out) : json(json), out(out) {}
+
+      bool parse() {
+        if (!this->consume('{')) {
+          return false;
+        }
+        if (this->consume('}')) {
+          return this->finish();
+        }
+        do {
+          std::string key;
+          if (!this->string(key) || !this->consume(':')) {
+            return false;
+          }
+          bool ok;
+          if (key == "tokens") {
+            ok = this->array([this]() { return this->arena_string(this->out.tokens); });
+          } else if (key == "token_logprobs") {
+            ok = this->array([this]() { return this->number(this->out.token_logprobs); });
+          } else if (key == "text_offset") {
+            ok = this->array([this]() { return this->integer(this->out.text_offsets); });
+          } else if (key == "top_logprobs") {
+            ok = this->null() || this->array([this]() { return this->top_entry(); });
+          } else {
+            ok = this->skip_value();
+          }
+          if (!ok) {
+            return false;
+          }
+        } while (this->consume(','));
+        return this->consume('}') && this->finish();
+      }
+
+     private:
+      // every array sized by token
+      bool finish() {
+        const auto size = this->out.tokens.size();
+        this->out.token_logprobs.resize(size, std::numeric_limits<float>::quiet_NaN());
+        this->out.text_offsets.resize(size, 0);
+        if (this->out.top_offsets.empty()) {
+          this->out.top_offsets.push_back(0);
+        }
+        this->out.top_offsets.resize(size + 1, this->out.top_offsets.back());
+        return true;
+      }
+
+      // {"token": logprob, ...} or null: the alternatives of one token
+      bool top_entry() {
+        if (this->out.top_offsets.empty()) {
+          this->out.top_offsets.push_back(0);
+        }
+        if (!this->null()) {
+          if (!this->consume('{')) {
+            return false;
+          }
+          if (!this->consume('}')) {
+            do {
+              if (!this->arena_string(this->out.top_tokens) || !this->consume(':') ||
+                  !this->number(this->out.top_logprobs)) {
+                return false;
+              }
+            } while (this->consume(','));
+            if (!this->consume('}')) {
+              return false;
+            }
+          }
+        }
+        this->out.top_offsets.push_back(static_cast<uint32_t>(this->out.top_tokens.size()));
+        return true;
+      }
+
+      template<typename Element>
+      bool array(Element element) {
+        if (!this->consume('[')) {
+          return false;
+        }
+        if (this->consume(']')) {
+          return true;
+        }
+        do {
+          if (!element()) {
+            return false;
+          }
+        } while (this->consume(','));
+        return this->consume(']');
+      }
+
+      void skip_whitespace() {
+        while (this->position < this->json.size()) {
+          const auto c = this->json[this->position];
+          if (c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+            return;
+          }
+          ++this->position;
+        }
+      }
+
+      bool consume(char expected) {
+        this->skip_whitespace();
+        if (this->position < this->json.size() && this->json[this->position] == expected) {
+          ++this->position;
+          return true;
+        }
+        return false;
+      }
+
+      bool null() {
+        this->skip_whitespace();
+        if (this->json.substr(this->position, 4) == "null") {
+          this->position += 4;
+          return true;
+        }
+        return false;
+      }
+
+      // a number, or null as NaN
+      bool number(std::vector<float> &values) {
+        if (this->null()) {
+          values.push_back(std::numeric_limits<float>::quiet_NaN());
+          return true;
+        }
+        const auto start = this->position;
+        if (auto fast = this->simple_number()) {
+          values.push_back(*fast);
+          return true;
+        }
+        this->position = start;
+        while (this->position < this->json.size()) {
+          const auto c = this->json[this->position];
+          if ((c < '0' || c > '9') && c != '-' && c != '+' && c != '.' && c != 'e' && c != 'E') {
+            break;
+          }
+          ++this->position;
+        }
+        const auto size = this->position - start;
+        char buffer[64];
+        if (size == 0 || size >= sizeof(buffer)) {
+          return false;
+        }
+        this->json.copy(buffer, size, start);
+        buffer[size] = '\0';
+        char *end = nullptr;
+        const auto value = std::strtof(buffer, &end);
+        if (end != buffer + size) {
+          return false;
+        }
+        values.push_back(value);
+        return true;
+      }
+
+      // -d.ddd[e-dd] with up to 15 significant digits and a small exponent, the usual logprob:
+      //  the digits and the power of ten are exact doubles, so their quotient is the correctly rounded double.
+      // Rounding that double to float gives the correctly rounded float unless it lies exactly halfway
+      //  between two floats (or among the subnormal floats): nothing then, nor for other numbers, left to strtof.
+      std::optional<float> simple_number() {
+        static constexpr double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                            1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                            1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        const bool negative = this->position < this->json.size() && this->json[this->position] == '-';
+        this->position += negative;
+        uint64_t mantissa = 0;
+        // significant digits, and all of them
+        int digits = 0;
+        int seen = 0;
+        int exponent = 0;
+        bool dot = false;
+        for (; this->position < this->json.size(); ++this->position) {
+          const auto c = this->json[this->position];
+          if (c >= '0' && c <= '9') {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(c - '0');
+            digits += mantissa != 0;
+            ++seen;
+            exponent -= dot;
+          } else if (c == '.' && !dot) {
+            dot = true;
+          } else {
+            break;
+          }
+        }
+        if (seen == 0 || digits > 15) {
+          return std::nullopt;
+        }
+        if (this->position < this->json.size() && (this->json[this->position] | 0x20) == 'e') {
+          ++this->position;
+          const bool negative_exponent = this->position < this->json.size() && this->json[this->position] == '-';
+          if (this->position < this->json.size() &&
+              (this->json[this->position] == '-' || this->json[this->position] == '+')) {
+            ++this->position;
+          }
+          int written = 0;
+          int exponent_digits = 0;
+          for (; this->position < this->json.size() && this->json[this->position] >= '0' &&
+                 this->json[this->position] <= '9' && exponent_digits < 4;
+               ++this->position, ++exponent_digits) {
+            written = written * 10 + (this->json[this->position] - '0');
+          }
+          if (exponent_digits == 0 || exponent_digits == 4) {
+            return std::nullopt;
+          }
+          exponent += negative_exponent ? -written : written;
+        }
+        if (exponent < -22 || exponent > 22) {
+          return std::nullopt;
+        }
+        auto value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+        // the 29 bits of the double below the float precision
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        if ((bits & 0x1FFFFFFF) == 0x10000000 || (value != 0 && value < std::numeric_limits<float>::min())) {
+          return std::nullopt;
+        }
+        return static_cast<float>(negative ? -value : value);
+      }
+
+      bool integer(std::vector<int64_t> &values) {
+        this->skip_whitespace();
+        const bool negative = this->position < this->json.size() && this->json[this->position] == '-';
+        this->position += negative;
+        const auto start = this->position;
+        int64_t value = 0;
+        while (this->position < this->json.size() && this->json[this->position] >= '0' &&
+               this->json[this->position] <= '9') {
+          value = value * 10 + (this->json[this->position++] - '0');
+        }
+        if (this->position == start) {
+          return false;
+        }
+        values.push_back(negative ? -value : value);
+        return true;
+      }
+
+      // a string appended to the arena
+      bool arena_string(std::vector<LogProbs::Span> &spans) {
+        const auto offset = this->out.arena.size();
+        if (!this->string(this->out.arena)) {
+          return false;
+        }
+        spans.push_back({static_cast<uint32_t>(offset), static_cast<uint32_t>(this->out.arena.size() - offset)});
+        return true;
+      }
+
+      // a string appended to `out`, unescaped
+      bool string(std::string &out) {
+        if (!this->consume('"')) {
+          return false;
+        }
+        while (this->position < this->json.size()) {
+          // copy the runs without escapes at once
+          const auto run_end = this->json.find_first_of("\"\\", this->position);
+          if (run_end == std::string_view::npos) {
+            return false;
+          }
+          out.append(this->json.data() + this->position, run_end - this->position);
+          this->position = run_end + 1;
+          if (this->json[run_end] == '"') {
+            return true;
+          }
+          if (this->position >= this->json.size()) {
+            return false;
+          }
+          const auto escaped = this->json[this->position++];
+          switch (escaped) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+              auto code_point = this->hex4();
+              if (!code_point) {
+                return false;
+              }
+              if (*code_point >= 0xD800 && *code_point < 0xDC00) {
+                // surrogate pair, a lone high surrogate is kept as is
+                if (this->json.substr(this->position, 2) == "\\u") {
+                  const auto saved = this->position;
+                  this->position += 2;
+                  const auto low = this->hex4();
+                  if (low && *low >= 0xDC00 && *low < 0xE000) {
+                    code_point = 0x10000 + ((*code_point - 0xD800) << 10) + (*low - 0xDC00);
+                  } else {
+                    this->position = saved;
+                  }
+                }
+              }
+              append_utf8(out, *code_point);
+              break;
+            }
+            default:
+              return false;
+          }
+        }
+        return false;
+      }
+
+      std::optional<uint32_t> hex4() {
+        if (this->position + 4 > this->json.size()) {
+          return std::nullopt;
+        }
+        uint32_t value = 0;
+        for (size_t i = 0; i < 4; ++i) {
+          const auto c = this->json[this->position++];
+          value <<= 4;
+          if (c >= '0' && c <= '9') {
+            value |= static_cast<uint32_t>(c - '0');
+          } else if (c >= 'a' && c <= 'f') {
+            value |= static_cast<uint32_t>(c - 'a' + 10);
+          } else if (c >= 'A' && c <= 'F') {
+            value |= static_cast<uint32_t>(c - 'A' + 10);
+          } else {
+            return std::nullopt;
+          }
+        }
+        return value;
+      }
+
+      static void append_utf8(std::string &out, uint32_t code_point) {
+        if (code_point < 0x80) {
+          out += static_cast<char>(code_point);
+        } else if (code_point < 0x800) {
+          out += static_cast<char>(0xC0 | (code_point >> 6));
+          out += static_cast<char>(0x80 | (code_point & 0x3F));
+        } else if (code_point < 0x10000) {
+          out += static_cast<char>(0xE0 | (code_point >> 12));
+          out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+          out += static_cast<char>(0x80 | (code_point & 0x3F));
+        } else {
+          out += static_cast<char>(0xF0 | (code_point >> 18));
+          out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+          out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+          out += static_cast<char>(0x80 | (code_point & 0x3F));
+        }
+      }
+
+      // any value of a member we do not know
+      bool skip_value() {
+        this->skip_whitespace();
+        if (this->position >= this->json.size()) {
+          return false;
+        }
+        const auto c = this->json[this->position];
+        if (c == '"') {
+          std::string ignored;
+          return this->string(ignored);
+        }
+        if (c == '[') {
+          return this->array([this]() { return this->skip_value(); });
+        }
+        if (c == '{') {
+          ++this->position;
+          if (this->consume('}')) {
+            return true;
+          }
+          do {
+            std::string ignored;
+            if (!this->string(ignored) || !this->consume(':') || !this->skip_value()) {
+              return false;
+            }
+          } while (this->consume(','));
+          return this->consume('}');
+        }
+        const auto end = this->json.find_first_of(",]} \n\r\t", this->position);
+        this->position = end == std::string_view::npos ? this->json.size() : end;
+        return true;
+      }
+    };
+
+    inline void append_string(std::string &out, std::string_view value) {
+      out += '"';
+      for (const auto c : value) {
+        switch (c) {
+          case '"': out += "\\\""; break;
+          case '\\': out += "\\\\"; break;
+          case '\n': out += "\\n"; break;
+          case '\r': out += "\\r"; break;
+          case '\t': out += "\\t"; break;
+          default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+              char buffer[8];
+              std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(c));
+              out += buffer;
+            } else {
+              out += c;
+            }
+        }
+      }
+      out += '"';
+    }
+
+    // The shortest decimal reading back as `value`, null for NaN
+    inline void append_number(std::string &out, float value) {
+      if (std::isnan(value)) {
+        out += "null";
+        return;
+      }
+      char buffer[32];
+      int n = 0;
+      for (int precision = 1; precision <= 9; ++precision) {
+        n = std::snprintf(buffer, sizeof(buffer), "%.*g", precision, static_cast<double>(value));
+        if (std::strtof(buffer, nullptr) == value) {
+          break;
+        }
+      }
+      out.append(buffer, static_cast<size_t>(n));
+    }
+  }
+
+  // Parse the `logprobs` object of a completion choice. Nothing when it is not valid.
+  inline std::optional<LogProbs> parse_logprobs(std::string_view json) {
+    LogProbs result;
+    if (!logprobs::Scanner(json, result).parse()) {
+      return std::nullopt;
+    }
+    return result;
+  }
+
+  // The `logprobs` object of a completion choice, as sent by the API
+  inline std::string to_json(const LogProbs &value) {
+    std::string out = "{\"tokens\":[";
+    for (size_t i = 0; i < value.size(); ++i) {
+      out += i == 0 ? "" : ",";
+      logprobs::append_string(out, value.token(i));
+    }
+    out += "],\"token_logprobs\":[";
+    for (size_t i = 0; i < value.size(); ++i) {
+      out += i == 0 ? "" : ",";
+      logprobs::append_number(out, value.token_logprobs[i]);
+    }
+    out += "],\"top_logprobs\":[";
+    for (size_t i = 0; i < value.size(); ++i) {
+      out += i == 0 ? "{" : ",{";
+      for (size_t k = 0; k < value.top_count(i); ++k) {
+        out += k == 0 ? "" : ",";
+        logprobs::append_string(out, value.top_token(i, k));
+        out += ':';
+        logprobs::append_number(out, value.top_logprob(i, k));
+      }
+      out += '}';
+    }
+    out += "],\"text_offset\":[";
+    for (size_t i = 0; i < value.size(); ++i) {
+      out += i == 0 ? "" : ",";
+      out += std::to_string(value.text_offsets[i]);
+    }
+    out += "]}";
+    return out;
+  }
+
+  // daw::json converters of the `logprobs` member
+  struct LogProbsFromJson {
+    std::optional<LogProbs> operator()() const { return std::nullopt; }
+
+    std::optional<LogProbs> operator()(std::string_view json) const {
+      if (json.empty() || json == "null") {
+        return std::nullopt;
+      }
+      auto result = parse_logprobs(json);
+      if (!result) {
+        throw std::runtime_error("invalid logprobs");
+      }
+      return result;
+    }
+  };
+
+  struct LogProbsToJson {
+    template<typename OutputIterator>
+    OutputIterator operator()(OutputIterator it, const std::optional<LogProbs> &value) const {
+      const auto json = value ? to_json(*value) : std::string("null");
+      for (const auto c : json) {
+        *it++ = c;
+      }
+      return it;
+    }
+  };
+}
@@ -2,6 +2,7 @@
 
 #include <tuple>
 #include <string>
+#include <vector>
 #include <daw/json/daw_json_link.h>
 
 namespace openai::models {
@@ -20,6 +21,12 @@ namespace openai::models {
     std::string model;
   };
 
+  // Several inputs classified in one call, the results come in the same order
+  struct ModerationBatchRequest {
+    std::vector<std::string> input;
+    std::string model;
+  };
+
   // Response
 
   struct ModerationResponseCategories {
@@ -70,6 +77,19 @@ namespace daw::json {
     }
   };
 
+  template<>
+  struct json_data_contract<openai::models::ModerationBatchRequest> {
+    static constexpr char const mem_input[] = "input";
+    static constexpr char const mem_model[] = "model";
+    using type = json_member_list<
+        json_array<mem_input, std::string, std::vector<std::string>>, json_string<mem_model>
+    >;
+
+    static inline auto to_json_data(openai::models::ModerationBatchRequest const &value) {
+      return std::forward_as_tuple(value.input, value.model);
+    }
+  };
+
   template<>
   struct json_data_contract<openai::models::ModerationResponseCategories> {
     static constexpr char const mem_hate[] = "hate";
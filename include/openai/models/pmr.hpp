@@ -0,0 +1,330 @@
+#pragma once
+
+#include <tuple>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <daw/json/daw_json_link.h>
+#include "commons.hpp"
+#include "fine_tune.hpp"
+
+// Responses whose strings and vectors are allocated from a std::pmr::memory_resource given when parsing them.
+// With a std::pmr::monotonic_buffer_resource tied to the call, a whole response is allocated in a few blocks
+//  and freed at once with the resource, without going through the global allocator for every member.
+// Same members as their counterpart of openai::models.
+namespace openai::models::pmr {
+  struct Model {
+    std::pmr::string id;
+    std::pmr::string object;
+    int64_t created;
+    std::pmr::string owned_by;
+  };
+
+  struct ListModelsResponse {
+    std::pmr::string object;
+    std::pmr::vector<Model> data;
+  };
+
+  struct OpenAIFile {
+    std::pmr::string id;
+    std::pmr::string object;
+    int64_t bytes;
+    int64_t created_at;
+    std::pmr::string filename;
+    std::pmr::string purpose;
+    std::pmr::string status;
+    std::optional<std::pmr::string> status_details;
+  };
+
+  struct ListFilesResponse {
+    std::pmr::string object;
+    std::pmr::vector<OpenAIFile> data;
+  };
+
+  struct FineTuneEvent {
+    std::pmr::string object;
+    int64_t created_at;
+    std::pmr::string level;
+    std::pmr::string message;
+  };
+
+  struct FineTune {
+    std::pmr::string id;
+    std::pmr::string object;
+    int64_t created_at;
+    int64_t updated_at;
+    std::pmr::string model;
+    std::optional<std::pmr::string> fine_tuned_model;
+    std::pmr::string organization_id;
+    std::pmr::string status;
+    openai::models::HyperParams hyperparams;
+    std::pmr::vector<OpenAIFile> training_files;
+    std::pmr::vector<OpenAIFile> validation_files;
+    std::pmr::vector<OpenAIFile> result_files;
+    std::optional<std::pmr::vector<FineTuneEvent>> events;
+  };
+
+  struct ListFineTune {
+    std::pmr::string object;
+    std::pmr::vector<FineTune> data;
+  };
+
+  struct ChatCompletionResponseMessage {
+    std::pmr::string role;
+    std::pmr::string content;
+  };
+
+  struct ChatCompletionResponseMessageWrapper {
+    ChatCompletionResponseMessage message;
+    std::pmr::string finish_reason;
+    int64_t index;
+  };
+
+  struct ChatCompletionsResponse {
+    std::pmr::string id;
+    std::pmr::string object;
+    int64_t created;
+    std::pmr::string model;
+    std::pmr::vector<ChatCompletionResponseMessageWrapper> choices;
+    openai::models::Usage usage;
+
+    std::string_view text() const {
+      if (this->choices.empty()) {
+        return "";
+      }
+      return this->choices[0].message.content;
+    }
+  };
+}
+
+// JSON defs
+namespace daw::json {
+  template<>
+  struct json_data_contract<openai::models::pmr::Model> {
+    static constexpr char const mem_id[] = "id";
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_created[] = "created";
+    static constexpr char const mem_owned_by[] = "owned_by";
+    using type = json_member_list<
+        json_string<mem_id, std::pmr::string>,
+        json_string<mem_object, std::pmr::string>,
+        json_number<mem_created, int64_t>,
+        json_string<mem_owned_by, std::pmr::string>
+    >;
+
+    static inline auto to_json_data(openai::models::pmr::Model const &value) {
+      return std::forward_as_tuple(value.id, value.object, value.created, value.owned_by);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::pmr::ListModelsResponse> {
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_data[] = "data";
+    using type = json_member_list<
+        json_string<mem_object, std::pmr::string>,
+        json_array<mem_data,
+                   json_class_no_name<openai::models::pmr::Model>,
+                   std::pmr::vector<openai::models::pmr::Model>>
+    >;
+
+    static inline auto to_json_data(openai::models::pmr::ListModelsResponse const &value) {
+      return std::forward_as_tuple(value.object, value.data);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::pmr::OpenAIFile> {
+    static constexpr char const mem_id[] = "id";
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_bytes[] = "bytes";
+    static constexpr char const mem_created_at[] = "created_at";
+    static constexpr char const mem_filename[] = "filename";
+    static constexpr char const mem_purpose[] = "purpose";
+    static constexpr char const mem_status[] = "status";
+    static constexpr char const mem_status_details[] = "status_details";
+    using type = json_member_list<
+        json_string<mem_id, std::pmr::string>,
+        json_string<mem_object, std::pmr::string>,
+        json_number<mem_bytes, int64_t>,
+        json_number<mem_created_at, int64_t>,
+        json_string<mem_filename, std::pmr::string>,
+        json_string<mem_purpose, std::pmr::string>,
+        json_string<mem_status, std::pmr::string>,
+        json_string_null<mem_status_details, std::optional<std::pmr::string>>
+    >;
+
+    static inline auto to_json_data(openai::models::pmr::OpenAIFile const &value) {
+      return std::forward_as_tuple(value.id,
+                                   value.object,
+                                   value.bytes,
+                                   value.created_at,
+                                   value.filename,
+                                   value.purpose,
+                                   value.status,
+                                   value.status_details);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::pmr::ListFilesResponse> {
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_data[] = "data";
+    using type = json_member_list<
+        json_string<mem_object, std::pmr::string>,
+        json_array<mem_data,
+                   json_class_no_name<openai::models::pmr::OpenAIFile>,
+                   std::pmr::vector<openai::models::pmr::OpenAIFile>>
+    >;
+
+    static inline auto to_json_data(openai::models::pmr::ListFilesResponse const &value) {
+      return std::forward_as_tuple(value.object, value.data);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::pmr::FineTuneEvent> {
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_created_at[] = "created_at";
+    static constexpr char const mem_level[] = "level";
+    static constexpr char const mem_message[] = "message";
+    using type = json_member_list<
+        json_string<mem_object, std::pmr::string>,
+        json_number<mem_created_at, int64_t>,
+        json_string<mem_level, std::pmr::string>,
+        json_string<mem_message, std::pmr::string>
+    >;
+
+    static inline auto to_json_data(openai::models::pmr::FineTuneEvent const &value) {
+      return std::forward_as_tuple(value.object, value.created_at, value.level, value.message);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::pmr::FineTune> {
+    static constexpr char const mem_id[] = "id";
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_created_at[] = "created_at";
+    static constexpr char const mem_updated_at[] = "updated_at";
+    static constexpr char const mem_model[] = "model";
+    static constexpr char const mem_fine_tuned_model[] = "fine_tuned_model";
+    static constexpr char const mem_organization_id[] = "organization_id";
+    static constexpr char const mem_status[] = "status";
+    static constexpr char const mem_hyperparams[] = "hyperparams";
+    static constexpr char const mem_training_files[] = "training_files";
+    static constexpr char const mem_validation_files[] = "validation_files";
+    static constexpr char const mem_result_files[] = "result_files";
+    static constexpr char const mem_events[] = "events";
+    using type = json_member_list<
+        json_string<mem_id, std::pmr::string>,
+        json_string<mem_object, std::pmr::string>,
+        json_number<mem_created_at, int64_t>,
+        json_number<mem_updated_at, int64_t>,
+        json_string<mem_model, std::pmr::string>,
+        json_string_null<mem_fine_tuned_model, std::optional<std::pmr::string>>,
+        json_string<mem_organization_id, std::pmr::string>,
+        json_string<mem_status, std::pmr::string>,
+        json_class<mem_hyperparams, openai::models::HyperParams>,
+        json_array<mem_training_files,
+                   json_class_no_name<openai::models::pmr::OpenAIFile>,
+                   std::pmr::vector<openai::models::pmr::OpenAIFile>>,
+        json_array<mem_validation_files,
+                   json_class_no_name<openai::models::pmr::OpenAIFile>,
+                   std::pmr::vector<openai::models::pmr::OpenAIFile>>,
+        json_array<mem_result_files,
+                   json_class_no_name<openai::models::pmr::OpenAIFile>,
+                   std::pmr::vector<openai::models::pmr::OpenAIFile>>,
+        json_array_null<mem_events,
+                        json_class_no_name<openai::models::pmr::FineTuneEvent>,
+                        std::optional<std::pmr::vector<openai::models::pmr::FineTuneEvent>>>
+    >;
+
+    static inline auto to_json_data(openai::models::pmr::FineTune const &value) {
+      return std::forward_as_tuple(value.id,
+                                   value.object,
+                                   value.created_at,
+                                   value.updated_at,
+                                   value.model,
+                                   value.fine_tuned_model,
+                                   value.organization_id,
+                                   value.status,
+                                   value.hyperparams,
+                                   value.training_files,
+                                   value.validation_files,
+                                   value.result_files,
+                                   value.events);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::pmr::ListFineTune> {
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_data[] = "data";
+    using type = json_member_list<
+        json_string<mem_object, std::pmr::string>,
+        json_array<mem_data,
+                   json_class_no_name<openai::models::pmr::FineTune>,
+                   std::pmr::vector<openai::models::pmr::FineTune>>
+    >;
+
+    static inline auto to_json_data(openai::models::pmr::ListFineTune const &value) {
+      return std::forward_as_tuple(value.object, value.data);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::pmr::ChatCompletionResponseMessage> {
+    static constexpr char const mem_role[] = "role";
+    static constexpr char const mem_content[] = "content";
+    using type = json_member_list<
+        json_string<mem_role, std::pmr::string>, json_string<mem_content, std::pmr::string>
+    >;
+
+    static inline auto to_json_data(openai::models::pmr::ChatCompletionResponseMessage const &value) {
+      return std::forward_as_tuple(value.role, value.content);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::pmr::ChatCompletionResponseMessageWrapper> {
+    static constexpr char const mem_message[] = "message";
+    static constexpr char const mem_finish_reason[] = "finish_reason";
+    static constexpr char const mem_index[] = "index";
+    using type = json_member_list<
+        json_class<mem_message, openai::models::pmr::ChatCompletionResponseMessage>,
+        json_string<mem_finish_reason, std::pmr::string>,
+        json_number<mem_index, int64_t>
+    >;
+
+    static inline auto to_json_data(openai::models::pmr::ChatCompletionResponseMessageWrapper const &value) {
+      return std::forward_as_tuple(value.message, value.finish_reason, value.index);
+    }
+  };
+
+  template<>
+  struct json_data_contract<openai::models::pmr::ChatCompletionsResponse> {
+    static constexpr char const mem_id[] = "id";
+    static constexpr char const mem_object[] = "object";
+    static constexpr char const mem_created[] = "created";
+    static constexpr char const mem_model[] = "model";
+    static constexpr char const mem_choices[] = "choices";
+    static constexpr char const mem_usage[] = "usage";
+    using type = json_member_list<
+        json_string<mem_id, std::pmr::string>,
+        json_string<mem_object, std::pmr::string>,
+        json_number<mem_created, int64_t>,
+        json_string<mem_model, std::pmr::string>,
+        json_array<mem_choices,
+                   json_class_no_name<openai::models::pmr::ChatCompletionResponseMessageWrapper>,
+                   std::pmr::vector<openai::models::pmr::ChatCompletionResponseMessageWrapper>>,
+        json_class<mem_usage, openai::models::Usage>
+    >;
+
+    static inline auto to_json_data(openai::models::pmr::ChatCompletionsResponse const &value) {
+      return std::forward_as_tuple(value.id, value.object, value.created, value.model, value.choices, value.usage);
+    }
+  };
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "openai/api_utils.hpp"
+#include "openai/enums.hpp"
+#include "openai/http/coalescer.hpp"
+#include "openai/models/moderations.hpp"
+
+namespace openai {
+  struct ModerationBatcherOptions {
+    AI_MODELS_MODERATIONS model = AI_MODELS_MODERATIONS::TextModerationLatest;
+    // How long the first caller of a batch waits for others to join it
+    std::chrono::microseconds window = std::chrono::milliseconds(5);
+    // A full batch is sent right away
+    size_t max_batch_size = 32;
+    // Verdicts remembered, the least recently used are forgotten first. 0 disables the cache
+    size_t cache_size = 10000;
+  };
+
+  // Moderates texts from many threads with few calls.
+  // Concurrent callers are coalesced into one array input call, sent `window` after the first one joined
+  //  or once full, see http::Coalescer.
+  // Verdicts are cached by input, identical inputs of a batch are sent once.
+  //
+  // Eg:
+  //  auto moderation = api.new_moderation_batcher();
+  //  // from any thread
+  //  if (moderation->moderate(message)->flagged) { ... }
+  class ModerationBatcher {
+   private:
+    // the inputs of a batch, each sent once
+    struct Inputs {
+      std::vector<std::string> inputs;
+      std::unordered_map<std::string, size_t> slots;
+    };
+
+    http::HttpClient *http_client;
+    ModerationBatcherOptions options;
+
+    // guards the cache
+    std::mutex mutex;
+    using CacheEntry = std::pair<std::string, models::ModerationResponseResult>;
+    std::list<CacheEntry> lru;
+    // keys are views on the inputs held by `lru`
+    std::unordered_map<std::string_view, std::list<CacheEntry>::iterator> cache;
+
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> cache_hits{0};
+
+    // last: destroyed first, it waits for the batches in flight which fill the cache
+    http::Coalescer<std::string, Inputs, std::vector<models::ModerationResponseResult>> coalescer;
+
+   public:
+    explicit ModerationBatcher(http::HttpClient *http_client, ModerationBatcherOptions options = {})
+        : http_client(http_client),
+          options(std::move(options)),
+          coalescer("/v1/moderations", this->options.window, [this](Inputs &batch, const http::RequestOptions &request_options) {
+            return this->send(batch, request_options);
+          }) {
+      this->options.max_batch_size = std::max<size_t>(1, this->options.max_batch_size);
+    }
+
+    ModerationBatcher(const ModerationBatcher &) = delete;
+    ModerationBatcher &operator=(const ModerationBatcher &) = delete;
+
+    // Classify `input`. Blocks for the batch window and the call, unless the verdict is cached.
+    Expected<models::ModerationResponseResult> moderate(const std::string &input,
+                                                        const http::RequestOptions &request_options = {}) {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto cached = this->cache.find(input);
+        if (cached != this->cache.end()) {
+          this->lru.splice(this->lru.begin(), this->lru, cached->second);
+          ++this->cache_hits;
+          return cached->second->second;
+        }
+      }
+
+      // every input goes to the same model: there is one open batch
+      size_t index = 0;
+      auto results = this->coalescer.submit(std::string(), request_options, [&](Inputs &batch) {
+        auto slot = batch.slots.find(input);
+        if (slot == batch.slots.end()) {
+          slot = batch.slots.emplace(input, batch.inputs.size()).first;
+          batch.inputs.push_back(input);
+        }
+        index = slot->second;
+        return batch.inputs.size() >= this->options.max_batch_size ? http::coalesce_full : http::coalesce_joined;
+      });
+      if (!results) {
+        return std::move(results).error();
+      }
+      return (**results)[index];
+    }
+
+    // Calls sent, and verdicts served from the cache
+    uint64_t sent_calls() const { return this->calls; }
+
+    uint64_t cached_verdicts() const { return this->cache_hits; }
+
+   private:
+    // called by the coalescer without any lock held
+    Expected<std::vector<models::ModerationResponseResult>> send(Inputs &batch,
+                                                                 const http::RequestOptions &request_options) {
+      models::ModerationBatchRequest request;
+      request.input = batch.inputs;
+      request.model = to_str(this->options.model);
+
+      ++this->calls;
+      auto response = this->http_client->try_post<models::ModerationBatchRequest, models::ModerationResponse>(
+          "/v1/moderations", request, request_options
+      );
+      if (!response) {
+        return std::move(response).error();
+      }
+      if (response->results.size() != batch.inputs.size()) {
+        Error error;
+        error.kind = error_parse;
+        error.status = 200;
+        error.path = "/v1/moderations";
+        error.detail = "expected " + std::to_string(batch.inputs.size()) + " moderation results, got " +
+            std::to_string(response->results.size());
+        return error;
+      }
+
+      std::lock_guard<std::mutex> lock(this->mutex);
+      for (const auto &slot : batch.slots) {
+        this->remember(slot.first, response->results[slot.second]);
+      }
+      return std::move(response->results);
+    }
+
+    // called with the lock held
+    void remember(const std::string &input, const models::ModerationResponseResult &result) {
+      if (this->options.cache_size == 0) {
+        return;
+      }
+      auto existing = this->cache.find(input);
+      if (existing != this->cache.end()) {
+        existing->second->second = result;
+        this->lru.splice(this->lru.begin(), this->lru, existing->second);
+        return;
+      }
+      this->lru.emplace_front(input, result);
+      this->cache.emplace(this->lru.front().first, this->lru.begin());
+      if (this->lru.size() > this->options.cache_size) {
+        this->cache.erase(this->lru.back().first);
+        this->lru.pop_back();
+      }
+    }
+  };
+}
@@ -1,9 +1,27 @@
 #pragma once
 
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <utility>
 #include "openai/api_utils.hpp"
+#include "openai/base64.hpp"
+#include "openai/chat_batcher.hpp"
+#include "openai/completions_batch.hpp"
 #include "openai/enums.hpp"
+#include "openai/fine_tune_watcher.hpp"
+#include "openai/image_batch.hpp"
+#include "openai/long_audio.hpp"
+#include "openai/moderation_batcher.hpp"
+#include "openai/packed_moderation.hpp"
+#include "openai/png.hpp"
+#include "openai/subtitles.hpp"
 
 // models
 #include "openai/models/models.hpp"
@@ -17,8 +35,19 @@
 #include "openai/models/embedding.hpp"
 #include "openai/models/audio.hpp"
 #include "openai/models/fine_tune.hpp"
+#include "openai/models/pmr.hpp"
 
 namespace openai {
+  // One set of credentials and the domain to use them with
+  struct APITarget {
+    std::string api_key;
+    // optional: Organization ID
+    std::string organization;
+    std::string domain = "https://api.openai.com";
+    // relative share of the traffic with http::LOAD_BALANCING_STRATEGY::weighted_random
+    unsigned weight = 1;
+  };
+
   class API {
    private:
     std::string api_key;
@@ -53,23 +82,65 @@ namespace openai {
       this->organization = std::move(organization);
       this->domain = std::move(domain);
 
-      this->http_client = new http::HttpClient(this->domain, this->create_authorization_headers());
+      this->http_client = new http::HttpClient(this->domain, create_authorization_headers(this->api_key, this->organization));
+    }
+
+    /// Create a new API object that spreads the requests over several API keys, organizations or domains.
+    /// Failing targets are ejected for a while, and failed calls are retried on another target when it is safe.
+    /// \param targets The (domain, api key, organization) to use. Eg: several organizations, or OpenAI compatible proxies
+    /// \param strategy How to pick the target of every call
+    /// \param health_policy When to eject a failing target
+    explicit API(const std::vector<APITarget> &targets,
+                 http::LOAD_BALANCING_STRATEGY strategy = http::least_outstanding_requests,
+                 http::HealthPolicy health_policy = {}) {
+      if (targets.empty()) {
+        throw std::runtime_error("at least one target is required when creating the OpenAI object");
+      }
+
+      std::vector<http::Target> http_targets;
+      for (const auto &target : targets) {
+        if (target.api_key.empty()) {
+          throw std::runtime_error("api key not found for target: " + target.domain);
+        }
+        http_targets.push_back({target.domain,
+                                create_authorization_headers(target.api_key, target.organization),
+                                target.weight});
+      }
+
+      this->api_key = targets.front().api_key;
+      this->organization = targets.front().organization;
+      this->domain = targets.front().domain;
+
+      this->http_client = new http::HttpClient(http_targets, strategy, std::move(health_policy));
     }
 
    private:
-    httplib::Headers create_authorization_headers() {
-      if (!this->organization.empty()) {
+    static httplib::Headers create_authorization_headers(const std::string &api_key, const std::string &organization) {
+      if (!organization.empty()) {
         return {
-            {"Authorization", "Bearer " + this->api_key},
-            {"OpenAI-Organization", this->organization},
+            {"Authorization", "Bearer " + api_key},
+            {"OpenAI-Organization", organization},
         };
       }
       return {
-          {"Authorization", "Bearer " + this->api_key}
+          {"Authorization", "Bearer " + api_key}
       };
     }
 
    public:
+    // Every endpoint accepts an optional http::RequestOptions as last argument,
+    //  with a deadline and a cancellation token for the call.
+    // Endpoints throw on failure (ApiError, carrying an openai::Error), the try_ variants
+    //  return an Expected holding either the response or the Error instead.
+
+    // Opt-in hedged requests: a call slower than most recent calls to the same endpoint
+    //  is duplicated on another connection and the first response wins.
+    // Must be called before sending requests.
+    // see: http::HedgingPolicy
+    void set_hedging_policy(const http::HedgingPolicy &policy) {
+      this->http_client->set_hedging_policy(policy);
+    }
+
     // Endpoints
 
     // Given a prompt, the model will return one or more predicted completions,
@@ -78,35 +149,90 @@ namespace openai {
     // see: https://platform.openai.com/docs/api-reference/completions
     models::CompletionsResponse *get_completions(const std::string &prompt,
                                                  const int max_tokens = 16,
-                                                 const AI_MODELS model = AI_MODELS::GPT3TextDavinci003
+                                                 const AI_MODELS model = AI_MODELS::GPT3TextDavinci003,
+                                                 const http::RequestOptions &options = {}
+    ) {
+      return this->try_get_completions(prompt, max_tokens, model, options).value();
+    }
+
+    // Same as get_completions, but returns the error instead of throwing it
+    Expected<models::CompletionsResponse *> try_get_completions(const std::string &prompt,
+                                                                const int max_tokens = 16,
+                                                                const AI_MODELS model = AI_MODELS::GPT3TextDavinci003,
+                                                                const http::RequestOptions &options = {}
     ) {
       auto req = models::get_default_completions_request();
       req.prompt = prompt;
       req.model = to_str(model);
       req.max_tokens = max_tokens;
 
-      return this->http_client->post<models::CompletionsRequest, models::CompletionsResponse *>(
+      return this->http_client->try_post<models::CompletionsRequest, models::CompletionsResponse *>(
+          "/v1/completions",
+          req,
+          options
+      );
+    }
+
+    // Same as get_completions, with every parameter of the request: logprobs, several prompts...
+    models::CompletionsResponse *get_completions(const models::CompletionsRequest &request,
+                                                 const http::RequestOptions &options = {}) {
+      return this->try_get_completions(request, options).value();
+    }
+
+    Expected<models::CompletionsResponse *> try_get_completions(const models::CompletionsRequest &request,
+                                                                const http::RequestOptions &options = {}) {
+      return this->http_client->try_post<models::CompletionsRequest, models::CompletionsResponse *>(
           "/v1/completions",
-          req
+          request,
+          options
       );
     }
 
+    // Complete many prompts with few calls: the prompts are sent in arrays, and the calls run in parallel.
+    // One result per prompt, in order, with its own error when its call failed.
+    // see: CompletionsBatch
+    std::vector<CompletionsBatchResult> get_completions_batch(
+        const std::vector<std::string> &prompts,
+        const int max_tokens = 16,
+        const AI_MODELS model = AI_MODELS::GPT3TextDavinci003,
+        const CompletionsBatchOptions &batch_options = {},
+        const http::RequestOptions &options = {}
+    ) {
+      auto req = models::get_default_completions_request();
+      req.model = to_str(model);
+      req.max_tokens = max_tokens;
+
+      return CompletionsBatch(this->http_client, batch_options).run(prompts, req, options);
+    }
+
     // Given a prompt and an instruction, the model will return an edited version of the prompt.
     // GET /v1/edits
     // see: https://platform.openai.com/docs/api-reference/edits
     models::EditsResponse *get_edits(
         const std::string &input,
         const std::string &instructions,
-        const AI_MODELS_EDITS model = AI_MODELS_EDITS::TextDavinciEdit001
+        const AI_MODELS_EDITS model = AI_MODELS_EDITS::TextDavinciEdit001,
+        const http::RequestOptions &options = {}
+    ) {
+      return this->try_get_edits(input, instructions, model, options).value();
+    }
+
+    // Same as get_edits, but returns the error instead of throwing it
+    Expected<models::EditsResponse *> try_get_edits(
+        const std::string &input,
+        const std::string &instructions,
+        const AI_MODELS_EDITS model = AI_MODELS_EDITS::TextDavinciEdit001,
+        const http::RequestOptions &options = {}
     ) {
       auto req = models::get_default_edits_request();
       req.input = input;
       req.instruction = instructions;
       req.model = to_str(model);
 
-      return this->http_client->post<models::EditsRequest, models::EditsResponse *>(
+      return this->http_client->try_post<models::EditsRequest, models::EditsResponse *>(
           "/v1/edits",
-          req
+          req,
+          options
       );
     }
 
@@ -114,22 +240,29 @@ namespace openai {
     // and provides basic information about each one such as the owner and availability.
     // GET /v1/models
     // see: https://platform.openai.com/docs/api-reference/models
-    models::ListModelsResponse *list_models() {
-      return this->http_client->get<models::ListModelsResponse *>("/v1/models");
+    models::ListModelsResponse *list_models(const http::RequestOptions &options = {}) {
+      return this->http_client->get<models::ListModelsResponse *>("/v1/models", options);
+    }
+
+    // Same as list_models, every string and vector of the response allocated from `resource`
+    // see: models::pmr
+    models::pmr::ListModelsResponse list_models(std::pmr::memory_resource *resource,
+                                                const http::RequestOptions &options = {}) {
+      return this->http_client->try_get_alloc<models::pmr::ListModelsResponse>("/v1/models", resource, options).value();
     }
 
     // Retrieves a model instance, providing basic information about the model such as the owner and permissioning.
     // GET /v1/models/{model_id}
     // see: https://platform.openai.com/docs/api-reference/models
-    models::Model *get_model(const std::string &model_id) {
-      return this->http_client->get<models::Model *>("/v1/models/" + model_id);
+    models::Model *get_model(const std::string &model_id, const http::RequestOptions &options = {}) {
+      return this->http_client->get<models::Model *>("/v1/models/" + model_id, options);
     }
 
     // Delete a fine-tuned model. You must have the Owner role in your organization.
     // DELETE /v1/models/{model_id}
     // see: https://platform.openai.com/docs/api-reference/models
-    models::ModelDeleteResponse *delete_model(const std::string &model_id) {
-      return this->http_client->delete_<models::ModelDeleteResponse *>("/v1/models/" + model_id);
+    models::ModelDeleteResponse *delete_model(const std::string &model_id, const http::RequestOptions &options = {}) {
+      return this->http_client->delete_<models::ModelDeleteResponse *>("/v1/models/" + model_id, options);
     }
 
     // Given a prompt and/or an input image, the model will generate a new image.
@@ -139,7 +272,19 @@ namespace openai {
         const std::string &prompt,
         const IMAGE_SIZE image_size = IMAGE_SIZE::px_1024_1024,
         const int number_of_images = 1,
-        const IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::url
+        const IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::url,
+        const http::RequestOptions &options = {}
+    ) {
+      return this->try_get_image(prompt, image_size, number_of_images, response_format, options).value();
+    }
+
+    // Same as get_image, but returns the error instead of throwing it
+    Expected<models::ImagesResponse *> try_get_image(
+        const std::string &prompt,
+        const IMAGE_SIZE image_size = IMAGE_SIZE::px_1024_1024,
+        const int number_of_images = 1,
+        const IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::url,
+        const http::RequestOptions &options = {}
     ) {
       models::ImagesGenerationsRequest request;
       request.size = to_str(image_size);
@@ -147,16 +292,83 @@ namespace openai {
       request.prompt = prompt;
       request.response_format = to_str(response_format);
 
-      return this->http_client->post<models::ImagesGenerationsRequest, models::ImagesResponse *>(
-          "/v1/images/generations", request
+      return this->http_client->try_post<models::ImagesGenerationsRequest, models::ImagesResponse *>(
+          "/v1/images/generations", request, options
       );
     }
 
+    // Same as get_image, without copying the strings of the response
+    // see: models::ImagesResponseView
+    std::unique_ptr<models::Retained<models::ImagesResponseView>> get_image_view(
+        const std::string &prompt,
+        const IMAGE_SIZE image_size = IMAGE_SIZE::px_1024_1024,
+        const int number_of_images = 1,
+        const IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::b64_json,
+        const http::RequestOptions &options = {}
+    ) {
+      models::ImagesGenerationsRequest request;
+      request.size = to_str(image_size);
+      request.n = number_of_images;
+      request.prompt = prompt;
+      request.response_format = to_str(response_format);
+
+      return this->http_client->try_post_view<models::ImagesGenerationsRequest, models::ImagesResponseView>(
+          "/v1/images/generations", request, options
+      ).value();
+    }
+
+    // Generate images and return their PNG bytes.
+    // The images are requested as b64_json and decoded straight from the response body.
+    std::vector<std::string> get_image_data(
+        const std::string &prompt,
+        const IMAGE_SIZE image_size = IMAGE_SIZE::px_1024_1024,
+        const int number_of_images = 1,
+        const http::RequestOptions &options = {}
+    ) {
+      auto response = this->get_image_view(prompt, image_size, number_of_images, IMAGE_RESPONSE_FORMAT::b64_json, options);
+
+      std::vector<std::string> images;
+      for (const auto &element : response->value.data) {
+        auto image = base64_decode(element.b64_json.value_or(""));
+        if (!image) {
+          Error error;
+          error.kind = error_parse;
+          error.status = 200;
+          error.path = "/v1/images/generations";
+          error.detail = "invalid base64 image";
+          throw_error(std::move(error));
+        }
+        images.push_back(std::move(*image));
+      }
+      return images;
+    }
+
+    // Generate images for many prompts in parallel, and download them as soon as they are ready.
+    // `on_image` is called once per image (or per failed prompt), as each one finishes.
+    // Blocks until the whole batch is done.
+    // see: ImageBatch, ImageBatchOptions
+    void generate_images(
+        const std::vector<std::string> &prompts,
+        const std::function<void(ImageBatchResult &&result)> &on_image,
+        const ImageBatchOptions &batch_options = {},
+        const http::RequestOptions &options = {}
+    ) {
+      ImageBatch(this->http_client, batch_options).run(prompts, on_image, options);
+    }
+
+    // Bound the number of calls in flight, over every thread using this API object. 0 for no limit.
+    // Calls over the limit wait for a slot, up to their deadline. Must be called before sending requests.
+    void set_max_concurrent_requests(size_t max_concurrent_requests) {
+      this->http_client->set_max_concurrent_requests(max_concurrent_requests);
+    }
+
     // Creates an edited or extended image given an original image and a prompt.
     // POST /v1/images/edits
     //
     // The image to edit must be a valid PNG file, less than 4MB, and square.
     //  If mask is not provided, image must have transparency, which will be used as the mask.
+    //  Images breaking these rules are rejected before being sent, with an error_invalid_input ApiError.
+    //  to_square_rgba_png converts an image that does not follow them, when built with CPPHTTPLIB_ZLIB_SUPPORT.
     //
     // mask:
     //  An additional image whose fully transparent areas (e.g. where alpha is zero) indicate where image should be edited.
@@ -169,47 +381,78 @@ namespace openai {
     // see: https://platform.openai.com/docs/api-reference/images
     models::ImagesResponse *get_image_edits(
         const std::string &prompt,
-        const std::string &image_data,
-        const std::string &mask_data = "",
+        std::string_view image_data,
+        std::string_view mask_data = "",
         const IMAGE_SIZE image_size = IMAGE_SIZE::px_1024_1024,
         const int number_of_images = 1,
-        const IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::url
+        const IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::url,
+        const http::RequestOptions &options = {}
     ) {
-      httplib::MultipartFormDataItems form_data = {
-          {"prompt", prompt, "", "text/plain"},
-          {"n", std::to_string(number_of_images), "", "text/plain"},
-          {"size", to_str(image_size), "", "text/plain"},
-          {"response_format", to_str(response_format), "", "text/plain"},
-          {"image", image_data, "image.png", "image/png"},
-      };
+      const auto mask = mask_data.empty() ? std::nullopt : read_png_info(mask_data);
+      check_image_input("/v1/images/edits", read_png_info(image_data), true, mask_data.empty() ? nullptr : &mask);
 
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_data("image", image_data, "image.png", "image/png");
       if (!mask_data.empty()) {
-        form_data.push_back({"mask", mask_data});
+        body->add_data("mask", mask_data, "mask.png", "image/png");
       }
+      return this->post_image_edits(prompt, body, image_size, number_of_images, response_format, options);
+    }
+
+    // Same as get_image_edits, but the image and the mask are streamed from disk
+    models::ImagesResponse *get_image_edits_from_file(
+        const std::string &prompt,
+        const std::string &image_path,
+        const std::string &mask_path = "",
+        const IMAGE_SIZE image_size = IMAGE_SIZE::px_1024_1024,
+        const int number_of_images = 1,
+        const IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::url,
+        const http::RequestOptions &options = {}
+    ) {
+      const auto mask = mask_path.empty() ? std::nullopt : read_png_info_from_file(mask_path);
+      check_image_input("/v1/images/edits", read_png_info_from_file(image_path), true, mask_path.empty() ? nullptr : &mask);
 
-      return this->http_client->post<models::ImagesResponse *>("/v1/images/edits", form_data);
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_file("image", image_path, "image.png", "image/png");
+      if (!mask_path.empty()) {
+        body->add_file("mask", mask_path, "mask.png", "image/png");
+      }
+      return this->post_image_edits(prompt, body, image_size, number_of_images, response_format, options);
     }
 
     // Create a variation of a given image
     // POST /v1/images/variations
     //
     // The image to use as the basis for the variation(s).
-    //  Must be a valid PNG file, less than 4MB, and square.
+    //  Must be a valid PNG file, less than 4MB, and square. Checked before being sent, see get_image_edits.
     // see: https://platform.openai.com/docs/api-reference/images
     models::ImagesResponse *get_image_variations(
-        const std::string &image_data,
+        std::string_view image_data,
         const IMAGE_SIZE image_size = IMAGE_SIZE::px_1024_1024,
         const int number_of_images = 1,
-        const IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::url
+        const IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::url,
+        const http::RequestOptions &options = {}
     ) {
-      httplib::MultipartFormDataItems form_data = {
-          {"n", std::to_string(number_of_images)},
-          {"size", to_str(image_size)},
-          {"response_format", to_str(response_format)},
-          {"image", image_data},
-      };
+      check_image_input("/v1/images/variations", read_png_info(image_data), false);
 
-      return this->http_client->post<models::ImagesResponse *>("/v1/images/variations", form_data);
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_data("image", image_data, "image.png", "image/png");
+      return this->post_image_variations(body, image_size, number_of_images, response_format, options);
+    }
+
+    // Same as get_image_variations, but the image is streamed from disk
+    models::ImagesResponse *get_image_variations_from_file(
+        const std::string &image_path,
+        const IMAGE_SIZE image_size = IMAGE_SIZE::px_1024_1024,
+        const int number_of_images = 1,
+        const IMAGE_RESPONSE_FORMAT response_format = IMAGE_RESPONSE_FORMAT::url,
+        const http::RequestOptions &options = {}
+    ) {
+      check_image_input("/v1/images/variations", read_png_info_from_file(image_path), false);
+
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_file("image", image_path, "image.png", "image/png");
+      return this->post_image_variations(body, image_size, number_of_images, response_format, options);
     }
 
     // Get a vector representation of a given input that can be easily consumed by machine learning models and algorithms.
@@ -218,15 +461,26 @@ namespace openai {
     models::EmbeddingResponse *get_embeddings(
         const std::string &input,
         const std::string &model = "text-embedding-ada-002",
-        const std::string &user = ""
+        const std::string &user = "",
+        const http::RequestOptions &options = {}
+    ) {
+      return this->try_get_embeddings(input, model, user, options).value();
+    }
+
+    // Same as get_embeddings, but returns the error instead of throwing it
+    Expected<models::EmbeddingResponse *> try_get_embeddings(
+        const std::string &input,
+        const std::string &model = "text-embedding-ada-002",
+        const std::string &user = "",
+        const http::RequestOptions &options = {}
     ) {
       models::EmbeddingRequest request;
       request.input = input;
       request.model = model;
       request.user = user;
 
-      return this->http_client->post<models::EmbeddingRequest, models::EmbeddingResponse *>(
-          "/v1/embeddings", request
+      return this->http_client->try_post<models::EmbeddingRequest, models::EmbeddingResponse *>(
+          "/v1/embeddings", request, options
       );
     }
 
@@ -234,6 +488,7 @@ namespace openai {
     /// POST /v1/audio/transcriptions
     //
     /// @param file The audio file to transcribe, in one of these formats: mp3, mp4, mpeg, mpga, m4a, wav, or webm.
+    ///         The format is detected from the first bytes of the audio.
     /// @param model ID of the model to use. Only whisper-1 is currently available.
     /// @param response_format The format of the transcript output, in one of these options: json, text, srt, verbose_json, or vtt.
     /// @param prompt An optional text to guide the model's style or continue a previous audio segment. The prompt should match the audio language.
@@ -244,66 +499,143 @@ namespace openai {
     ///
     /// see: https://platform.openai.com/docs/api-reference/audio
     models::AudioResponse *get_audio_transcription(
-        const std::string &audio,
+        std::string_view audio,
         const std::string &model = "whisper-1",
         const AUDIO_RESPONSE_FORMAT response_format = AUDIO_RESPONSE_FORMAT::json,
         const std::string &prompt = "",
         const int temperature = 0,
-        const std::string &language = ""
+        const std::string &language = "",
+        const http::RequestOptions &options = {}
     ) {
-      httplib::MultipartFormDataItems form_data = {
-          {"file", audio},
-          {"model", model},
-          {"response_format", to_str(response_format)},
-          {"temperature", std::to_string(temperature)},
-      };
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_data("file", audio, API::audio_file_name(audio));
+      return this->post_audio("/v1/audio/transcriptions", body, model, response_format, prompt, temperature, language, options);
+    }
 
-      if (!prompt.empty()) {
-        form_data.push_back({"prompt", prompt});
-      }
+    // Same as get_audio_transcription, but the audio is streamed from disk.
+    // The file name is sent along, the API uses its extension to detect the audio format.
+    models::AudioResponse *get_audio_transcription_from_file(
+        const std::string &path,
+        const std::string &model = "whisper-1",
+        const AUDIO_RESPONSE_FORMAT response_format = AUDIO_RESPONSE_FORMAT::json,
+        const std::string &prompt = "",
+        const int temperature = 0,
+        const std::string &language = "",
+        const http::RequestOptions &options = {}
+    ) {
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_file("file", path, std::filesystem::path(path).filename().string());
+      return this->post_audio("/v1/audio/transcriptions", body, model, response_format, prompt, temperature, language, options);
+    }
 
-      if (!prompt.empty()) {
-        form_data.push_back({"language", language});
-      }
+    // Same as get_audio_transcription, with the timed segments of the transcript.
+    // response_format must be verbose_json, srt or vtt: the segments point into the retained response body.
+    // see: models::VerboseAudioResponseView, parse_transcript
+    std::unique_ptr<models::Retained<models::VerboseAudioResponseView>> get_audio_transcription_segments(
+        std::string_view audio,
+        const AUDIO_RESPONSE_FORMAT response_format = AUDIO_RESPONSE_FORMAT::verbose_json,
+        const std::string &model = "whisper-1",
+        const std::string &prompt = "",
+        const int temperature = 0,
+        const std::string &language = "",
+        const http::RequestOptions &options = {}
+    ) {
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_data("file", audio, API::audio_file_name(audio));
+      return this->post_audio_segments("/v1/audio/transcriptions", body, model, response_format, prompt, temperature, language, options);
+    }
 
-      return this->http_client->post<models::AudioResponse *>("/v1/audio/transcriptions", form_data);
+    // Same as get_audio_transcription_segments, but the audio is streamed from disk
+    std::unique_ptr<models::Retained<models::VerboseAudioResponseView>> get_audio_transcription_segments_from_file(
+        const std::string &path,
+        const AUDIO_RESPONSE_FORMAT response_format = AUDIO_RESPONSE_FORMAT::verbose_json,
+        const std::string &model = "whisper-1",
+        const std::string &prompt = "",
+        const int temperature = 0,
+        const std::string &language = "",
+        const http::RequestOptions &options = {}
+    ) {
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_file("file", path, std::filesystem::path(path).filename().string());
+      return this->post_audio_segments("/v1/audio/transcriptions", body, model, response_format, prompt, temperature, language, options);
     }
 
     /// Translates audio into into English.
     /// POST /v1/audio/translations
     //
     /// @param file The audio file to transcribe, in one of these formats: mp3, mp4, mpeg, mpga, m4a, wav, or webm.
+    ///         The format is detected from the first bytes of the audio.
     /// @param model ID of the model to use. Only whisper-1 is currently available.
     /// @param response_format The format of the transcript output, in one of these options: json, text, srt, verbose_json, or vtt.
     /// @param prompt An optional text to guide the model's style or continue a previous audio segment. The prompt should match the audio language.
     ///         see: https://platform.openai.com/docs/guides/speech-to-text/prompting
     /// @param temperature The sampling temperature, between 0 and 1. Higher values like 0.8 will make the output more random, while lower values like 0.2 will make it more focused and deterministic. If set to 0, the model will use log probability to automatically increase the temperature until certain thresholds are hit.
+    /// @param language Ignored, the translations endpoint always outputs English. Kept for compatibility
     ///
     /// see: https://platform.openai.com/docs/api-reference/audio
     models::AudioResponse *get_audio_translation(
-        const std::string &audio,
+        std::string_view audio,
         const std::string &model = "whisper-1",
         const AUDIO_RESPONSE_FORMAT response_format = AUDIO_RESPONSE_FORMAT::json,
         const std::string &prompt = "",
         const int temperature = 0,
-        const std::string &language = ""
+        [[maybe_unused]] const std::string &language = "",
+        const http::RequestOptions &options = {}
     ) {
-      httplib::MultipartFormDataItems form_data = {
-          {"file", audio},
-          {"model", model},
-          {"response_format", to_str(response_format)},
-          {"temperature", std::to_string(temperature)},
-      };
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_data("file", audio, API::audio_file_name(audio));
+      return this->post_audio("/v1/audio/translations", body, model, response_format, prompt, temperature, "", options);
+    }
 
-      if (!prompt.empty()) {
-        form_data.push_back({"prompt", prompt});
-      }
+    // Same as get_audio_translation, but the audio is streamed from disk.
+    // The file name is sent along, the API uses its extension to detect the audio format.
+    models::AudioResponse *get_audio_translation_from_file(
+        const std::string &path,
+        const std::string &model = "whisper-1",
+        const AUDIO_RESPONSE_FORMAT response_format = AUDIO_RESPONSE_FORMAT::json,
+        const std::string &prompt = "",
+        const int temperature = 0,
+        [[maybe_unused]] const std::string &language = "",
+        const http::RequestOptions &options = {}
+    ) {
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_file("file", path, std::filesystem::path(path).filename().string());
+      return this->post_audio("/v1/audio/translations", body, model, response_format, prompt, temperature, "", options);
+    }
 
-      if (!prompt.empty()) {
-        form_data.push_back({"language", language});
-      }
+    // Transcribe, or translate, an audio file of any length.
+    // WAV files are split into chunks transcribed in parallel, and stitched back into one transcription.
+    // Render it with to_srt or to_vtt for subtitles.
+    // see: LongAudioTranscriber, LongAudioOptions
+    models::VerboseAudioResponse *get_long_audio_transcription(
+        const std::string &path,
+        const LongAudioOptions &audio_options = {},
+        const http::RequestOptions &options = {}
+    ) {
+      return new models::VerboseAudioResponse(this->try_get_long_audio_transcription(path, audio_options, options).value());
+    }
 
-      return this->http_client->post<models::AudioResponse *>("/v1/audio/transcriptions", form_data);
+    // Same as get_long_audio_transcription, but returns the error instead of throwing it
+    Expected<models::VerboseAudioResponse> try_get_long_audio_transcription(
+        const std::string &path,
+        const LongAudioOptions &audio_options = {},
+        const http::RequestOptions &options = {}
+    ) {
+      return LongAudioTranscriber(this->http_client, audio_options).run(path, options);
+    }
+
+    // One chat completion, without history: every string and vector of the response allocated from `resource`
+    // POST /v1/chat/completions
+    // see: models::pmr
+    models::pmr::ChatCompletionsResponse get_chat_completion(const models::ChatCompletionRequest &request,
+                                                             std::pmr::memory_resource *resource,
+                                                             const http::RequestOptions &options = {}) {
+      if (request.stream) {
+        throw std::runtime_error("stream for chat is not enabled for now. Feel free to open a PR!");
+      }
+      return this->http_client->try_post_alloc<models::ChatCompletionRequest, models::pmr::ChatCompletionsResponse>(
+          "/v1/chat/completions", request, resource, options
+      ).value();
     }
 
     // Generate a new chat object with the given model
@@ -315,8 +647,15 @@ namespace openai {
     // Returns a list of files that belong to the user's organization.
     // GET /v1/files
     // see: https://platform.openai.com/docs/api-reference/files
-    models::ListFilesResponse *get_files() {
-      return this->http_client->get<models::ListFilesResponse *>("/v1/files");
+    models::ListFilesResponse *get_files(const http::RequestOptions &options = {}) {
+      return this->http_client->get<models::ListFilesResponse *>("/v1/files", options);
+    }
+
+    // Same as get_files, every string and vector of the response allocated from `resource`
+    // see: models::pmr
+    models::pmr::ListFilesResponse get_files(std::pmr::memory_resource *resource,
+                                             const http::RequestOptions &options = {}) {
+      return this->http_client->try_get_alloc<models::pmr::ListFilesResponse>("/v1/files", resource, options).value();
     }
 
     /// Upload a file that contains document(s) to be used across various endpoints/features
@@ -333,85 +672,465 @@ namespace openai {
     models::OpenAIFile *upload_file(
         const std::string &file_content,
         const std::string &file_name,
-        const std::string &purpose = "fine-tune"
+        const std::string &purpose = "fine-tune",
+        const http::RequestOptions &options = {}
     ) {
       httplib::MultipartFormDataItems form_data = {
           {"file", file_content, file_name},
           {"purpose", purpose},
       };
 
-      return this->http_client->post<models::OpenAIFile *>("/v1/files", form_data);
+      return this->http_client->post<models::OpenAIFile *>("/v1/files", form_data, options);
+    }
+
+    /// Upload a file from disk. The file is streamed in fixed-size chunks,
+    ///  the memory used does not depend on its size.
+    /// POST /v1/files
+    //
+    /// @param path Path of the JSON Lines file to be uploaded. See upload_file
+    /// @param purpose The intended purpose of the uploaded documents. See upload_file
+    /// @param file_name The name of the file. Defaults to the name of the file on disk
+    ///
+    /// see: https://platform.openai.com/docs/api-reference/files/upload
+    models::OpenAIFile *upload_file_from_path(
+        const std::string &path,
+        const std::string &purpose = "fine-tune",
+        const std::string &file_name = "",
+        const http::RequestOptions &options = {}
+    ) {
+      auto body = std::make_shared<http::MultipartBody>();
+      body->add_field("purpose", purpose);
+      body->add_file("file", path, file_name.empty() ? path.substr(path.find_last_of("/\\") + 1) : file_name);
+
+      return this->http_client->post<models::OpenAIFile *>("/v1/files", body, options);
     }
 
     // Returns information about a specific file.
     // GET /v1/files/{file_id}
     // see: https://platform.openai.com/docs/api-reference/files
-    models::OpenAIFile *get_file(const std::string &file_id) {
-      return this->http_client->get<models::OpenAIFile *>("/v1/files/" + file_id);
+    models::OpenAIFile *get_file(const std::string &file_id, const http::RequestOptions &options = {}) {
+      return this->http_client->get<models::OpenAIFile *>("/v1/files/" + file_id, options);
     }
 
     // Delete a file
     // DELETE /v1/files/{file_id}
     // see: https://platform.openai.com/docs/api-reference/files
-    models::FileDeleteResponse *delete_file(const std::string &file_id) {
-      return this->http_client->delete_<models::FileDeleteResponse *>("/v1/files/" + file_id);
+    models::FileDeleteResponse *delete_file(const std::string &file_id, const http::RequestOptions &options = {}) {
+      return this->http_client->delete_<models::FileDeleteResponse *>("/v1/files/" + file_id, options);
     }
 
     /// Returns the contents of the specified file
     /// GET /v1/files/{file_id}/content
     /// see: https://platform.openai.com/docs/api-reference/files
-    std::string get_file_content(const std::string &file_id) {
-      return this->http_client->get<std::string>("/v1/files/" + file_id + "/content");
+    std::string get_file_content(const std::string &file_id, const http::RequestOptions &options = {}) {
+      return this->http_client->get<std::string>("/v1/files/" + file_id + "/content", options);
+    }
+
+    /// Stream the contents of the specified file to `sink` as it is received, without buffering it
+    /// GET /v1/files/{file_id}/content
+    //
+    /// @param sink Called with every received chunk. Return false to cancel the download
+    /// @param progress Optional: called with the received and total byte counts. Return false to cancel the download
+    ///
+    /// see: https://platform.openai.com/docs/api-reference/files
+    void get_file_content(
+        const std::string &file_id,
+        const std::function<bool(const char *data, size_t length)> &sink,
+        const std::function<bool(uint64_t received, uint64_t total)> &progress = nullptr,
+        const http::RequestOptions &options = {}
+    ) {
+      this->http_client->try_get_stream("/v1/files/" + file_id + "/content", {}, nullptr, sink, progress, options).value();
+    }
+
+    /// Download the contents of the specified file straight to `local_path`
+    /// GET /v1/files/{file_id}/content
+    //
+    /// @param local_path Where to write the file
+    /// @param progress Optional: called with the bytes on disk and the total file size. Return false to cancel the download
+    /// @param resume If `local_path` holds the beginning of this file from an interrupted download,
+    ///                only the missing bytes are requested with a range request. The range is kept only when the
+    ///                server confirms it starts at the end of the local file, and a complete local file only when
+    ///                its size is the size of the remote file: otherwise the whole file is downloaded again
+    /// @return the size of the file on disk
+    ///
+    /// see: https://platform.openai.com/docs/api-reference/files
+    uint64_t download_file_content(
+        const std::string &file_id,
+        const std::string &local_path,
+        const std::function<bool(uint64_t received, uint64_t total)> &progress = nullptr,
+        const bool resume = false,
+        const http::RequestOptions &options = {}
+    ) {
+      if (resume) {
+        std::ifstream existing(local_path, std::ios::binary | std::ios::ate);
+        if (existing && existing.tellg() > 0) {
+          const auto offset = static_cast<uint64_t>(existing.tellg());
+          existing.close();
+          if (auto size = this->download_file_from(file_id, local_path, offset, progress, options)) {
+            return *size;
+          }
+        }
+      }
+      return *this->download_file_from(file_id, local_path, 0, progress, options);
     }
 
     // List your organization's fine-tuning jobs
     // GET /v1/fine-tunes
-    models::ListFineTune *list_fine_tunes() {
-      return this->http_client->get<models::ListFineTune *>("/v1/fine-tunes");
+    models::ListFineTune *list_fine_tunes(const http::RequestOptions &options = {}) {
+      return this->http_client->get<models::ListFineTune *>("/v1/fine-tunes", options);
+    }
+
+    // Same as list_fine_tunes, every string and vector of the response allocated from `resource`
+    // see: models::pmr
+    models::pmr::ListFineTune list_fine_tunes(std::pmr::memory_resource *resource,
+                                              const http::RequestOptions &options = {}) {
+      return this->http_client->try_get_alloc<models::pmr::ListFineTune>("/v1/fine-tunes", resource, options).value();
+    }
+
+    // Same as list_fine_tunes, without copying the strings of the response
+    // see: models::ListFineTuneView
+    std::unique_ptr<models::Retained<models::ListFineTuneView>> list_fine_tunes_view(
+        const http::RequestOptions &options = {}
+    ) {
+      return this->http_client->try_get_view<models::ListFineTuneView>("/v1/fine-tunes", options).value();
     }
 
     // Gets info about the fine-tune job
     // GET /v1/fine-tunes/{fine_tune_id}
-    models::FineTune *get_fine_tune(const std::string &fine_tune_id) {
-      return this->http_client->get<models::FineTune *>("/v1/fine-tunes/" + fine_tune_id);
+    models::FineTune *get_fine_tune(const std::string &fine_tune_id, const http::RequestOptions &options = {}) {
+      return this->http_client->get<models::FineTune *>("/v1/fine-tunes/" + fine_tune_id, options);
     }
 
     // Get fine-grained status updates for a fine-tune job
     // GET /v1/fine-tunes/{fine_tune_id}/events
-    models::ListFineTuneEvents *get_fine_tune_events(const std::string &fine_tune_id) {
-      return this->http_client->get<models::ListFineTuneEvents *>("/v1/fine-tunes/" + fine_tune_id + "/events");
+    models::ListFineTuneEvents *get_fine_tune_events(const std::string &fine_tune_id,
+                                                     const http::RequestOptions &options = {}) {
+      return this->http_client->get<models::ListFineTuneEvents *>("/v1/fine-tunes/" + fine_tune_id + "/events", options);
+    }
+
+    // Same as get_fine_tune_events, without copying the strings of the response
+    // see: models::ListFineTuneEventsView
+    std::unique_ptr<models::Retained<models::ListFineTuneEventsView>> get_fine_tune_events_view(
+        const std::string &fine_tune_id,
+        const http::RequestOptions &options = {}
+    ) {
+      return this->http_client->try_get_view<models::ListFineTuneEventsView>(
+          "/v1/fine-tunes/" + fine_tune_id + "/events", options
+      ).value();
+    }
+
+    // Follow fine-tune jobs from a background thread, without polling them by hand
+    // see: FineTuneWatcher
+    std::unique_ptr<FineTuneWatcher> new_fine_tune_watcher(const FineTuneWatchPolicy &policy = {}) {
+      return std::make_unique<FineTuneWatcher>(this->http_client, policy);
     }
 
     // Creates a job that fine-tunes a specified model from a given dataset.
     //  Response includes details of the enqueued job including job status and the name of the fine-tuned models once complete.
     // POST /v1/fine-tunes
     // see: https://platform.openai.com/docs/guides/fine-tuning
-    models::FineTune *create_fine_tune(const models::FineTuneRequest &fine_tune_request) {
+    models::FineTune *create_fine_tune(const models::FineTuneRequest &fine_tune_request,
+                                       const http::RequestOptions &options = {}) {
       return this->http_client->post<models::FineTuneRequest, models::FineTune *>(
           "/v1/fine-tunes",
-          fine_tune_request
+          fine_tune_request,
+          options
       );
     }
 
     // Immediately cancel a fine-tune job.
     // POST /v1/fine-tunes/{fine_tune_id}/cancel
-    models::FineTune *cancel_fine_tune(const std::string &fine_tune_id) {
-      return this->http_client->post<models::FineTune *>("/v1/fine-tunes/" + fine_tune_id + "/cancel");
+    models::FineTune *cancel_fine_tune(const std::string &fine_tune_id, const http::RequestOptions &options = {}) {
+      return this->http_client->post<models::FineTune *>("/v1/fine-tunes/" + fine_tune_id + "/cancel", options);
     }
 
     // Classifies if text violates OpenAI's Content Policy
     // POST /moderations
     models::ModerationResponse *get_moderations(
         const std::string &input,
-        const AI_MODELS_MODERATIONS model = AI_MODELS_MODERATIONS::TextModerationLatest
+        const AI_MODELS_MODERATIONS model = AI_MODELS_MODERATIONS::TextModerationLatest,
+        const http::RequestOptions &options = {}
+    ) {
+      return this->try_get_moderations(input, model, options).value();
+    }
+
+    // Same as get_moderations, but returns the error instead of throwing it
+    Expected<models::ModerationResponse *> try_get_moderations(
+        const std::string &input,
+        const AI_MODELS_MODERATIONS model = AI_MODELS_MODERATIONS::TextModerationLatest,
+        const http::RequestOptions &options = {}
     ) {
       models::ModerationRequest request;
-      request.input = "";
+      request.input = input;
       request.model = to_str(model);
-      return this->http_client->post<models::ModerationRequest, models::ModerationResponse *>(
+      return this->http_client->try_post<models::ModerationRequest, models::ModerationResponse *>(
           "/v1/moderations",
-          request
+          request,
+          options
       );
     }
+
+    // Classifies several texts in one call, the results are in the order of the inputs
+    // POST /moderations
+    models::ModerationResponse *get_moderations_batch(
+        const std::vector<std::string> &inputs,
+        const AI_MODELS_MODERATIONS model = AI_MODELS_MODERATIONS::TextModerationLatest,
+        const http::RequestOptions &options = {}
+    ) {
+      return this->try_get_moderations_batch(inputs, model, options).value();
+    }
+
+    // Same as get_moderations_batch, but returns the error instead of throwing it
+    Expected<models::ModerationResponse *> try_get_moderations_batch(
+        const std::vector<std::string> &inputs,
+        const AI_MODELS_MODERATIONS model = AI_MODELS_MODERATIONS::TextModerationLatest,
+        const http::RequestOptions &options = {}
+    ) {
+      models::ModerationBatchRequest request;
+      request.input = inputs;
+      request.model = to_str(model);
+      return this->http_client->try_post<models::ModerationBatchRequest, models::ModerationResponse *>(
+          "/v1/moderations",
+          request,
+          options
+      );
+    }
+
+    // Moderate texts from many threads: concurrent calls are sent together, and verdicts are cached
+    // see: ModerationBatcher
+    std::unique_ptr<ModerationBatcher> new_moderation_batcher(const ModerationBatcherOptions &batcher_options = {}) {
+      return std::make_unique<ModerationBatcher>(this->http_client, batcher_options);
+    }
+
+    // Generate chat completions from many threads: concurrent requests differing only by `n` share one call
+    // see: ChatBatcher
+    std::unique_ptr<ChatBatcher> new_chat_batcher(const ChatBatcherOptions &batcher_options = {}) {
+      return std::make_unique<ChatBatcher>(this->http_client, batcher_options);
+    }
+
+   private:
+    // Reject the images the endpoint would refuse, before uploading them
+    static void check_image_input(const std::string &path,
+                                  const std::optional<PngInfo> &image,
+                                  bool edit,
+                                  const std::optional<PngInfo> *mask = nullptr) {
+      auto problem = image_input_problem(image, edit, mask);
+      if (!problem.empty()) {
+        Error error;
+        error.kind = error_invalid_input;
+        error.path = path;
+        error.detail = std::move(problem);
+        throw_error(std::move(error));
+      }
+    }
+
+    models::ImagesResponse *post_image_edits(
+        const std::string &prompt,
+        const std::shared_ptr<http::MultipartBody> &body,
+        const IMAGE_SIZE image_size,
+        const int number_of_images,
+        const IMAGE_RESPONSE_FORMAT response_format,
+        const http::RequestOptions &options
+    ) {
+      body->add_field("prompt", prompt);
+      body->add_field("n", std::to_string(number_of_images));
+      body->add_field("size", to_str(image_size));
+      body->add_field("response_format", to_str(response_format));
+      return this->http_client->post<models::ImagesResponse *>("/v1/images/edits", body, options);
+    }
+
+    models::ImagesResponse *post_image_variations(
+        const std::shared_ptr<http::MultipartBody> &body,
+        const IMAGE_SIZE image_size,
+        const int number_of_images,
+        const IMAGE_RESPONSE_FORMAT response_format,
+        const http::RequestOptions &options
+    ) {
+      body->add_field("n", std::to_string(number_of_images));
+      body->add_field("size", to_str(image_size));
+      body->add_field("response_format", to_str(response_format));
+      return this->http_client->post<models::ImagesResponse *>("/v1/images/variations", body, options);
+    }
+
+    // Parse the first byte and the total size of a `Content-Range: bytes <first>-<last>/<total>` header,
+    //  or of `bytes */<total>`, where the first byte is left out
+    static bool parse_content_range(const std::string &value, std::optional<uint64_t> &first, uint64_t &total) {
+      constexpr std::string_view unit = "bytes ";
+      if (value.compare(0, unit.size(), unit) != 0) {
+        return false;
+      }
+      const auto slash = value.find('/', unit.size());
+      if (slash == std::string::npos) {
+        return false;
+      }
+      const auto number = [&value](size_t begin, size_t end, uint64_t &out) {
+        const auto result = std::from_chars(value.data() + begin, value.data() + end, out);
+        return result.ec == std::errc() && result.ptr != value.data() + begin;
+      };
+      if (!number(slash + 1, value.size(), total)) {
+        return false;
+      }
+      first.reset();
+      if (value.compare(unit.size(), slash - unit.size(), "*") != 0) {
+        const auto dash = value.find('-', unit.size());
+        uint64_t start = 0;
+        if (dash == std::string::npos || dash > slash || !number(unit.size(), dash, start)) {
+          return false;
+        }
+        first = start;
+      }
+      return true;
+    }
+
+    // Download the file to `local_path` from byte `offset`, appended to the first `offset` bytes on disk.
+    // Returns std::nullopt when the server cannot confirm the bytes on disk are the beginning of the file:
+    //  a range that does not start at `offset`, or a 416 while the remote file is not `offset` bytes long.
+    std::optional<uint64_t> download_file_from(
+        const std::string &file_id,
+        const std::string &local_path,
+        uint64_t offset,
+        const std::function<bool(uint64_t received, uint64_t total)> &progress,
+        const http::RequestOptions &options
+    ) {
+      httplib::Headers range;
+      if (offset > 0) {
+        range.emplace("Range", "bytes=" + std::to_string(offset) + "-");
+      }
+
+      std::ofstream file;
+      uint64_t written = 0;
+      bool mismatch = false;
+      auto status = this->http_client->try_get_stream(
+          "/v1/files/" + file_id + "/content",
+          range,
+          [&](const httplib::Response &response) {
+            // 200: the server ignored the range, start over
+            if (response.status == 200) {
+              offset = 0;
+            } else {
+              std::optional<uint64_t> first;
+              uint64_t total = 0;
+              if (!parse_content_range(response.get_header_value("Content-Range"), first, total) ||
+                  first != offset || total <= offset) {
+                mismatch = true;
+                return false;
+              }
+            }
+            file.open(local_path, std::ios::binary | (response.status == 206 ? std::ios::app : std::ios::trunc));
+            return file.is_open();
+          },
+          [&](const char *data, size_t length) {
+            file.write(data, static_cast<std::streamsize>(length));
+            written += length;
+            return file.good();
+          },
+          [&](uint64_t received, uint64_t total) {
+            return !progress || progress(offset + received, offset + total);
+          },
+          options);
+
+      if (mismatch) {
+        return std::nullopt;
+      }
+      // 416: the range starts at or past the end of the remote file,
+      //  the local file is complete only when both have the same size
+      if (!status && offset > 0 && status.error().status == 416) {
+        auto remote = this->http_client->try_get<models::OpenAIFile>("/v1/files/" + file_id, options);
+        if (remote && remote->bytes >= 0 && static_cast<uint64_t>(remote->bytes) == offset) {
+          return offset;
+        }
+        return std::nullopt;
+      }
+      std::move(status).value();
+      return offset + written;
+    }
+
+    // The API detects the audio format from the extension of the file name:
+    //  name in-memory audio after the format its first bytes identify
+    static std::string audio_file_name(std::string_view audio) {
+      const auto starts_with = [&audio](size_t offset, std::string_view magic) {
+        return audio.size() >= offset + magic.size() && audio.substr(offset, magic.size()) == magic;
+      };
+      if (starts_with(0, "RIFF") && starts_with(8, "WAVE")) {
+        return "audio.wav";
+      }
+      if (starts_with(4, "ftyp")) {
+        return starts_with(8, "M4A") ? "audio.m4a" : "audio.mp4";
+      }
+      if (starts_with(0, "\x1A\x45\xDF\xA3")) {
+        return "audio.webm";
+      }
+      if (starts_with(0, "OggS")) {
+        return "audio.ogg";
+      }
+      if (starts_with(0, "fLaC")) {
+        return "audio.flac";
+      }
+      // MPEG audio: an ID3 tag, or directly a frame sync
+      if (starts_with(0, "ID3") ||
+          (audio.size() >= 2 && static_cast<unsigned char>(audio[0]) == 0xFF &&
+              (static_cast<unsigned char>(audio[1]) & 0xE0) == 0xE0)) {
+        return "audio.mp3";
+      }
+      return "audio";
+    }
+
+    models::AudioResponse *post_audio(
+        const std::string &path,
+        const std::shared_ptr<http::MultipartBody> &body,
+        const std::string &model,
+        const AUDIO_RESPONSE_FORMAT response_format,
+        const std::string &prompt,
+        const int temperature,
+        const std::string &language,
+        const http::RequestOptions &options
+    ) {
+      body->add_field("model", model);
+      body->add_field("response_format", to_str(response_format));
+      body->add_field("temperature", std::to_string(temperature));
+      if (!prompt.empty()) {
+        body->add_field("prompt", prompt);
+      }
+      if (!language.empty()) {
+        body->add_field("language", language);
+      }
+      if (response_format == AUDIO_RESPONSE_FORMAT::json || response_format == AUDIO_RESPONSE_FORMAT::verbose_json) {
+        return this->http_client->post<models::AudioResponse *>(path, body, options);
+      }
+      // text, srt and vtt are not JSON: the whole body is the text
+      return new models::AudioResponse{this->http_client->post<std::string>(path, body, options)};
+    }
+
+    std::unique_ptr<models::Retained<models::VerboseAudioResponseView>> post_audio_segments(
+        const std::string &path,
+        const std::shared_ptr<http::MultipartBody> &body,
+        const std::string &model,
+        const AUDIO_RESPONSE_FORMAT response_format,
+        const std::string &prompt,
+        const int temperature,
+        const std::string &language,
+        const http::RequestOptions &options
+    ) {
+      if (response_format != AUDIO_RESPONSE_FORMAT::verbose_json && response_format != AUDIO_RESPONSE_FORMAT::srt &&
+          response_format != AUDIO_RESPONSE_FORMAT::vtt) {
+        Error error;
+        error.kind = error_invalid_input;
+        error.path = path;
+        error.detail = std::string("no segments in the ") + to_str(response_format) + " format";
+        throw_error(std::move(error));
+      }
+
+      body->add_field("model", model);
+      body->add_field("response_format", to_str(response_format));
+      body->add_field("temperature", std::to_string(temperature));
+      if (!prompt.empty()) {
+        body->add_field("prompt", prompt);
+      }
+      if (!language.empty()) {
+        body->add_field("language", language);
+      }
+      auto response = this->http_client->post<std::string>(path, body, options);
+      return parse_transcript(std::move(response), response_format, path).value();
+    }
   };
 }
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "openai/models/moderations.hpp"
+
+#if defined(__AVX__)
+#define OPENAI_MODERATION_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define OPENAI_MODERATION_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define OPENAI_MODERATION_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace openai {
+  enum MODERATION_CATEGORY {
+    moderation_hate,
+    moderation_hate_threatening,
+    moderation_self_harm,
+    moderation_sexual,
+    moderation_sexual_minors,
+    moderation_violence,
+    moderation_violence_graphic,
+  };
+
+  inline constexpr size_t moderation_category_count = 7;
+
+  inline const char *to_str(MODERATION_CATEGORY category) {
+    switch (category) {
+      case moderation_hate: return "hate";
+      case moderation_hate_threatening: return "hate/threatening";
+      case moderation_self_harm: return "self-harm";
+      case moderation_sexual: return "sexual";
+      case moderation_sexual_minors: return "sexual/minors";
+      case moderation_violence: return "violence";
+      case moderation_violence_graphic: return "violence/graphic";
+    }
+    return "";
+  }
+
+  // A moderation result in 32 bytes, without heap allocation: the scores in MODERATION_CATEGORY order
+  //  and the categories flagged by the API as a bitmask.
+  // Laid out to be read as one 8 floats vector, see ModerationPolicy.
+  struct alignas(32) PackedModeration {
+    float scores[moderation_category_count] = {};
+    // bit `1 << category` for every flagged category
+    uint8_t categories = 0;
+    bool flagged = false;
+
+    static PackedModeration pack(const models::ModerationResponseResult &result) {
+      PackedModeration packed;
+      const auto &scores = result.category_scores;
+      packed.scores[moderation_hate] = scores.hate;
+      packed.scores[moderation_hate_threatening] = scores.hate_threatening;
+      packed.scores[moderation_self_harm] = scores.self_harm;
+      packed.scores[moderation_sexual] = scores.sexual;
+      packed.scores[moderation_sexual_minors] = scores.sexual_minors;
+      packed.scores[moderation_violence] = scores.violence;
+      packed.scores[moderation_violence_graphic] = scores.violence_graphic;
+
+      const auto &categories = result.categories;
+      const bool flags[moderation_category_count] = {categories.hate, categories.hate_threatening, categories.self_harm,
+                                                     categories.sexual, categories.sexual_minors, categories.violence,
+                                                     categories.violence_graphic};
+      for (size_t i = 0; i < moderation_category_count; ++i) {
+        packed.categories |= static_cast<uint8_t>(flags[i] << i);
+      }
+      packed.flagged = result.flagged;
+      return packed;
+    }
+
+    static std::vector<PackedModeration> pack(const models::ModerationResponse &response) {
+      std::vector<PackedModeration> packed;
+      packed.reserve(response.results.size());
+      for (const auto &result : response.results) {
+        packed.push_back(PackedModeration::pack(result));
+      }
+      return packed;
+    }
+
+    bool category(MODERATION_CATEGORY category) const {
+      return (this->categories >> category) & 1;
+    }
+
+    float score(MODERATION_CATEGORY category) const {
+      return this->scores[category];
+    }
+  };
+
+  static_assert(sizeof(PackedModeration) == 32, "PackedModeration must fit one 32 bytes vector");
+
+  // Your own moderation rules: a result breaks the policy when any score is over its category threshold.
+  // Evaluated on many packed results at once with SSE2, AVX or NEON when available.
+  class ModerationPolicy {
+   private:
+    // the 8th lane faces the flags of PackedModeration: +inf never compares lower
+    alignas(32) float thresholds[8];
+
+   public:
+    // The same threshold for every category
+    explicit ModerationPolicy(float threshold = 0.5f) {
+      for (size_t i = 0; i < moderation_category_count; ++i) {
+        this->thresholds[i] = threshold;
+      }
+      this->thresholds[7] = std::numeric_limits<float>::infinity();
+    }
+
+    // Scores over `threshold` break the policy, a threshold of 1 or more disables the category
+    ModerationPolicy &set(MODERATION_CATEGORY category, float threshold) {
+      this->thresholds[category] = threshold;
+      return *this;
+    }
+
+    float threshold(MODERATION_CATEGORY category) const {
+      return this->thresholds[category];
+    }
+
+    // The categories over their threshold, as a bitmask like PackedModeration::categories
+    uint8_t evaluate(const PackedModeration &result) const {
+#if defined(OPENAI_MODERATION_AVX)
+      const auto scores = _mm256_load_ps(reinterpret_cast<const float *>(&result));
+      const auto over = _mm256_cmp_ps(scores, _mm256_load_ps(this->thresholds), _CMP_GT_OQ);
+      return static_cast<uint8_t>(_mm256_movemask_ps(over));
+#elif defined(OPENAI_MODERATION_SSE)
+      const auto *scores = reinterpret_cast<const float *>(&result);
+      const auto low = _mm_cmpgt_ps(_mm_load_ps(scores), _mm_load_ps(this->thresholds));
+      const auto high = _mm_cmpgt_ps(_mm_load_ps(scores + 4), _mm_load_ps(this->thresholds + 4));
+      return static_cast<uint8_t>(_mm_movemask_ps(low) | (_mm_movemask_ps(high) << 4));
+#elif defined(OPENAI_MODERATION_NEON)
+      static const uint32_t lane_bits[4] = {1, 2, 4, 8};
+      const auto bits = vld1q_u32(lane_bits);
+      const auto *scores = reinterpret_cast<const float *>(&result);
+      const auto low = vandq_u32(vcgtq_f32(vld1q_f32(scores), vld1q_f32(this->thresholds)), bits);
+      const auto high = vandq_u32(vcgtq_f32(vld1q_f32(scores + 4), vld1q_f32(this->thresholds + 4)), bits);
+      return static_cast<uint8_t>(vaddvq_u32(low) | (vaddvq_u32(high) << 4));
+#else
+      uint8_t mask = 0;
+      for (size_t i = 0; i < moderation_category_count; ++i) {
+        mask |= static_cast<uint8_t>((result.scores[i] > this->thresholds[i]) << i);
+      }
+      return mask;
+#endif
+    }
+
+    bool violated(const PackedModeration &result) const {
+      return this->evaluate(result) != 0;
+    }
+
+    // Evaluate `count` results into `masks`. Returns the number of results breaking the policy
+    size_t evaluate(const PackedModeration *results, size_t count, uint8_t *masks) const {
+      size_t violations = 0;
+      for (size_t i = 0; i < count; ++i) {
+        masks[i] = this->evaluate(results[i]);
+        violations += masks[i] != 0;
+      }
+      return violations;
+    }
+
+    std::vector<uint8_t> evaluate(const std::vector<PackedModeration> &results) const {
+      std::vector<uint8_t> masks(results.size());
+      this->evaluate(results.data(), results.size(), masks.data());
+      return masks;
+    }
+  };
+}
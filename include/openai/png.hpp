@@ -0,0 +1,485 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "openai/http/multipart.hpp"
+
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+#include <zlib.h>
+#endif
+
+namespace openai {
+  // The images sent to /v1/images/edits and /v1/images/variations must be under this size
+  inline constexpr uint64_t max_image_input_size = 4 * 1024 * 1024;
+
+  enum PNG_COLOR_TYPE {
+    png_grayscale = 0,
+    png_rgb = 2,
+    png_palette = 3,
+    png_grayscale_alpha = 4,
+    png_rgba = 6,
+  };
+
+  // What the header of a PNG tells about the image, see read_png_info
+  struct PngInfo {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t bit_depth = 0;
+    uint8_t color_type = 0;
+    bool interlaced = false;
+    // alpha channel, or transparency given by a tRNS chunk
+    bool has_alpha = false;
+    // size of the whole file
+    uint64_t size = 0;
+
+    bool is_square() const { return this->width == this->height; }
+  };
+
+  namespace png {
+    inline constexpr unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+    inline uint32_t read_u32(const unsigned char *data) {
+      return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+    }
+
+    inline bool valid_format(uint8_t color_type, uint8_t bit_depth) {
+      switch (color_type) {
+        case png_grayscale:
+          return bit_depth == 1 || bit_depth == 2 || bit_depth == 4 || bit_depth == 8 || bit_depth == 16;
+        case png_palette:
+          return bit_depth == 1 || bit_depth == 2 || bit_depth == 4 || bit_depth == 8;
+        case png_rgb:
+        case png_grayscale_alpha:
+        case png_rgba:
+          return bit_depth == 8 || bit_depth == 16;
+        default:
+          return false;
+      }
+    }
+
+    // Walk the chunks up to the image data: only their 8 bytes headers are read.
+    // `read(offset, buffer, length)` returns the number of bytes read.
+    template<typename Read>
+    std::optional<PngInfo> scan(uint64_t size, const Read &read) {
+      // signature + IHDR
+      unsigned char header[33];
+      if (size < sizeof(header) || read(0, header, sizeof(header)) != sizeof(header) ||
+          std::memcmp(header, signature, sizeof(signature)) != 0 ||
+          read_u32(header + 8) != 13 || std::memcmp(header + 12, "IHDR", 4) != 0) {
+        return std::nullopt;
+      }
+
+      PngInfo info;
+      info.size = size;
+      info.width = read_u32(header + 16);
+      info.height = read_u32(header + 20);
+      info.bit_depth = header[24];
+      info.color_type = header[25];
+      info.interlaced = header[28] == 1;
+      if (info.width == 0 || info.height == 0 || !valid_format(info.color_type, info.bit_depth) || header[28] > 1) {
+        return std::nullopt;
+      }
+      info.has_alpha = info.color_type == png_grayscale_alpha || info.color_type == png_rgba;
+
+      // tRNS, when there is one, is before the first IDAT
+      uint64_t offset = sizeof(header);
+      unsigned char chunk[8];
+      while (offset + sizeof(chunk) <= size && read(offset, chunk, sizeof(chunk)) == sizeof(chunk)) {
+        if (std::memcmp(chunk + 4, "IDAT", 4) == 0) {
+          return info;
+        }
+        if (std::memcmp(chunk + 4, "tRNS", 4) == 0) {
+          info.has_alpha = true;
+        }
+        offset += 12 + uint64_t(read_u32(chunk));
+      }
+      // no image data
+      return std::nullopt;
+    }
+  }
+
+  // Read the size, format and transparency of a PNG image, without decoding it.
+  // Nothing when the data is not a PNG.
+  inline std::optional<PngInfo> read_png_info(std::string_view data) {
+    return png::scan(data.size(), [&data](uint64_t offset, unsigned char *buffer, size_t length) {
+      if (offset >= data.size()) {
+        return size_t(0);
+      }
+      length = std::min<size_t>(length, data.size() - offset);
+      std::memcpy(buffer, data.data() + offset, length);
+      return length;
+    });
+  }
+
+  // Same as read_png_info, reading only the headers from the file
+  inline std::optional<PngInfo> read_png_info_from_file(const std::string &path) {
+    http::FileReader reader(path);
+    return png::scan(reader.size(), [&reader](uint64_t offset, unsigned char *buffer, size_t length) {
+      return reader.read_at(offset, reinterpret_cast<char *>(buffer), length);
+    });
+  }
+
+  // Why an image cannot be sent to /v1/images/edits or /v1/images/variations, empty when it can.
+  // `mask` is the mask of an edit, when there is one: it must have the dimensions of the image.
+  //  Without a mask, an edited image must have transparency.
+  inline std::string image_input_problem(const std::optional<PngInfo> &image,
+                                         bool edit,
+                                         const std::optional<PngInfo> *mask = nullptr) {
+    if (!image) {
+      return "image is not a valid PNG";
+    }
+    if (image->size >= max_image_input_size) {
+      return "image must be less than 4MB, got " + std::to_string(image->size) + " bytes";
+    }
+    if (!image->is_square()) {
+      return "image must be square, got " + std::to_string(image->width) + "x" + std::to_string(image->height);
+    }
+    if (mask) {
+      if (!*mask) {
+        return "mask is not a valid PNG";
+      }
+      if ((*mask)->size >= max_image_input_size) {
+        return "mask must be less than 4MB, got " + std::to_string((*mask)->size) + " bytes";
+      }
+      if ((*mask)->width != image->width || (*mask)->height != image->height) {
+        return "mask must have the dimensions of the image";
+      }
+    } else if (edit && !image->has_alpha) {
+      return "image must have transparency when there is no mask";
+    }
+    return "";
+  }
+
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+  namespace png {
+    // 8 bits RGBA pixels
+    struct Bitmap {
+      uint32_t width = 0;
+      uint32_t height = 0;
+      std::vector<uint8_t> pixels;
+    };
+
+    inline uint8_t paeth(int a, int b, int c) {
+      const int p = a + b - c;
+      const int pa = std::abs(p - a);
+      const int pb = std::abs(p - b);
+      const int pc = std::abs(p - c);
+      if (pa <= pb && pa <= pc) {
+        return static_cast<uint8_t>(a);
+      }
+      return static_cast<uint8_t>(pb <= pc ? b : c);
+    }
+
+    inline std::optional<Bitmap> decode(std::string_view data) {
+      auto info = read_png_info(data);
+      if (!info || info->interlaced) {
+        return std::nullopt;
+      }
+
+      std::string compressed;
+      std::string_view palette;
+      std::string_view transparency;
+      const auto *bytes = reinterpret_cast<const unsigned char *>(data.data());
+      for (size_t offset = 8; offset + 12 <= data.size();) {
+        const auto length = read_u32(bytes + offset);
+        if (length > data.size() - offset - 12) {
+          return std::nullopt;
+        }
+        const auto type = data.substr(offset + 4, 4);
+        const auto content = data.substr(offset + 8, length);
+        if (type == "IDAT") {
+          compressed.append(content);
+        } else if (type == "PLTE") {
+          palette = content;
+        } else if (type == "tRNS") {
+          transparency = content;
+        } else if (type == "IEND") {
+          break;
+        }
+        offset += 12 + size_t(length);
+      }
+
+      const size_t channels = info->color_type == png_rgb ? 3
+          : info->color_type == png_grayscale_alpha ? 2
+          : info->color_type == png_rgba ? 4 : 1;
+      const size_t bits = channels * info->bit_depth;
+      const size_t stride = (size_t(info->width) * bits + 7) / 8;
+      const size_t bpp = std::max<size_t>(1, bits / 8);
+      if (info->color_type == png_palette && palette.empty()) {
+        return std::nullopt;
+      }
+
+      // deflate does not compress more than 1032:1, do not trust larger dimensions
+      const uint64_t raw_bytes = uint64_t(info->height) * (stride + 1);
+      if (raw_bytes / 1032 > compressed.size()) {
+        return std::nullopt;
+      }
+      std::vector<uint8_t> raw(raw_bytes);
+      auto raw_size = static_cast<uLongf>(raw.size());
+      if (uncompress(raw.data(), &raw_size, reinterpret_cast<const Bytef *>(compressed.data()),
+                     static_cast<uLong>(compressed.size())) != Z_OK || raw_size != raw.size()) {
+        return std::nullopt;
+      }
+
+      // undo the filters, in place
+      for (size_t y = 0; y < info->height; ++y) {
+        auto *row = raw.data() + y * (stride + 1) + 1;
+        const auto *previous = y == 0 ? nullptr : row - (stride + 1);
+        for (size_t x = 0; x < stride; ++x) {
+          const int a = x >= bpp ? row[x - bpp] : 0;
+          const int b = previous ? previous[x] : 0;
+          const int c = previous && x >= bpp ? previous[x - bpp] : 0;
+          switch (row[-1]) {
+            case 0:
+              break;
+            case 1:
+              row[x] = static_cast<uint8_t>(row[x] + a);
+              break;
+            case 2:
+              row[x] = static_cast<uint8_t>(row[x] + b);
+              break;
+            case 3:
+              row[x] = static_cast<uint8_t>(row[x] + (a + b) / 2);
+              break;
+            case 4:
+              row[x] = static_cast<uint8_t>(row[x] + paeth(a, b, c));
+              break;
+            default:
+              return std::nullopt;
+          }
+        }
+      }
+
+      // n-th sample of a row, scaled to 8 bits (the raw value for palette indexes)
+      const auto sample = [&info](const uint8_t *row, size_t n) -> int {
+        switch (info->bit_depth) {
+          case 16:
+            return row[n * 2];
+          case 8:
+            return row[n];
+          default: {
+            const size_t bit = n * info->bit_depth;
+            const int value = (row[bit / 8] >> (8 - info->bit_depth - bit % 8)) & ((1 << info->bit_depth) - 1);
+            return info->color_type == png_palette ? value : value * 255 / ((1 << info->bit_depth) - 1);
+          }
+        }
+      };
+      // tRNS transparent color of grayscale and RGB images, compared at full depth
+      const auto key = [&info, &transparency](size_t channel) -> int {
+        const auto value = (int(uint8_t(transparency[channel * 2])) << 8) | uint8_t(transparency[channel * 2 + 1]);
+        return info->bit_depth == 16 ? value : value & ((1 << info->bit_depth) - 1);
+      };
+      const auto full = [&info](const uint8_t *row, size_t n) -> int {
+        if (info->bit_depth == 16) {
+          return (row[n * 2] << 8) | row[n * 2 + 1];
+        }
+        if (info->bit_depth == 8) {
+          return row[n];
+        }
+        const size_t bit = n * info->bit_depth;
+        return (row[bit / 8] >> (8 - info->bit_depth - bit % 8)) & ((1 << info->bit_depth) - 1);
+      };
+
+      Bitmap bitmap;
+      bitmap.width = info->width;
+      bitmap.height = info->height;
+      bitmap.pixels.resize(size_t(info->width) * info->height * 4);
+      for (size_t y = 0; y < info->height; ++y) {
+        const auto *row = raw.data() + y * (stride + 1) + 1;
+        auto *out = bitmap.pixels.data() + y * info->width * 4;
+        for (size_t x = 0; x < info->width; ++x, out += 4) {
+          switch (info->color_type) {
+            case png_grayscale:
+              out[0] = out[1] = out[2] = static_cast<uint8_t>(sample(row, x));
+              out[3] = transparency.size() >= 2 && full(row, x) == key(0) ? 0 : 255;
+              break;
+            case png_rgb:
+              for (size_t c = 0; c < 3; ++c) {
+                out[c] = static_cast<uint8_t>(sample(row, x * 3 + c));
+              }
+              out[3] = transparency.size() >= 6 && full(row, x * 3) == key(0) &&
+                  full(row, x * 3 + 1) == key(1) && full(row, x * 3 + 2) == key(2) ? 0 : 255;
+              break;
+            case png_palette: {
+              const size_t index = size_t(sample(row, x));
+              if (index * 3 + 2 >= palette.size()) {
+                return std::nullopt;
+              }
+              for (size_t c = 0; c < 3; ++c) {
+                out[c] = uint8_t(palette[index * 3 + c]);
+              }
+              out[3] = index < transparency.size() ? uint8_t(transparency[index]) : 255;
+              break;
+            }
+            case png_grayscale_alpha:
+              out[0] = out[1] = out[2] = static_cast<uint8_t>(sample(row, x * 2));
+              out[3] = static_cast<uint8_t>(sample(row, x * 2 + 1));
+              break;
+            default:
+              for (size_t c = 0; c < 4; ++c) {
+                out[c] = static_cast<uint8_t>(sample(row, x * 4 + c));
+              }
+          }
+        }
+      }
+      return bitmap;
+    }
+
+    // Center the image on a transparent square
+    inline Bitmap square(const Bitmap &bitmap) {
+      if (bitmap.width == bitmap.height) {
+        return bitmap;
+      }
+      Bitmap out;
+      out.width = out.height = std::max(bitmap.width, bitmap.height);
+      out.pixels.assign(size_t(out.width) * out.height * 4, 0);
+      const size_t left = (out.width - bitmap.width) / 2;
+      const size_t top = (out.height - bitmap.height) / 2;
+      for (size_t y = 0; y < bitmap.height; ++y) {
+        std::memcpy(out.pixels.data() + ((top + y) * out.width + left) * 4,
+                    bitmap.pixels.data() + y * bitmap.width * 4,
+                    size_t(bitmap.width) * 4);
+      }
+      return out;
+    }
+
+    // Box filter downscale of a square image, colors weighted by their alpha
+    inline Bitmap downscale(const Bitmap &bitmap, uint32_t side) {
+      Bitmap out;
+      out.width = out.height = side;
+      out.pixels.resize(size_t(side) * side * 4);
+      const uint64_t from = bitmap.width;
+      for (uint64_t y = 0; y < side; ++y) {
+        const auto y0 = y * from / side;
+        const auto y1 = std::max(y0 + 1, (y + 1) * from / side);
+        for (uint64_t x = 0; x < side; ++x) {
+          const auto x0 = x * from / side;
+          const auto x1 = std::max(x0 + 1, (x + 1) * from / side);
+          uint64_t sums[4] = {0, 0, 0, 0};
+          for (auto sy = y0; sy < y1; ++sy) {
+            const auto *pixel = bitmap.pixels.data() + (sy * from + x0) * 4;
+            for (auto sx = x0; sx < x1; ++sx, pixel += 4) {
+              sums[0] += uint64_t(pixel[0]) * pixel[3];
+              sums[1] += uint64_t(pixel[1]) * pixel[3];
+              sums[2] += uint64_t(pixel[2]) * pixel[3];
+              sums[3] += pixel[3];
+            }
+          }
+          auto *pixel = out.pixels.data() + (y * side + x) * 4;
+          const auto count = (y1 - y0) * (x1 - x0);
+          for (size_t c = 0; c < 3; ++c) {
+            pixel[c] = sums[3] == 0 ? 0 : static_cast<uint8_t>((sums[c] + sums[3] / 2) / sums[3]);
+          }
+          pixel[3] = static_cast<uint8_t>((sums[3] + count / 2) / count);
+        }
+      }
+      return out;
+    }
+
+    inline void append_chunk(std::string &out, const char *type, const std::string &content) {
+      const auto length = static_cast<uint32_t>(content.size());
+      const char size[4] = {char(length >> 24), char(length >> 16), char(length >> 8), char(length)};
+      out.append(size, 4);
+      const auto start = out.size();
+      out.append(type, 4);
+      out.append(content);
+      const auto crc = crc32(0, reinterpret_cast<const Bytef *>(out.data() + start), static_cast<uInt>(out.size() - start));
+      const char crc_bytes[4] = {char(crc >> 24), char(crc >> 16), char(crc >> 8), char(crc)};
+      out.append(crc_bytes, 4);
+    }
+
+    // 8 bits RGBA PNG, every row with the filter giving the smallest sum of absolute differences
+    inline std::optional<std::string> encode(const Bitmap &bitmap) {
+      const size_t stride = size_t(bitmap.width) * 4;
+      std::vector<uint8_t> raw(size_t(bitmap.height) * (stride + 1));
+      std::array<std::vector<uint8_t>, 5> candidates;
+      for (auto &candidate : candidates) {
+        candidate.resize(stride);
+      }
+      for (size_t y = 0; y < bitmap.height; ++y) {
+        const auto *row = bitmap.pixels.data() + y * stride;
+        const auto *previous = y == 0 ? nullptr : row - stride;
+        for (size_t x = 0; x < stride; ++x) {
+          const int a = x >= 4 ? row[x - 4] : 0;
+          const int b = previous ? previous[x] : 0;
+          const int c = previous && x >= 4 ? previous[x - 4] : 0;
+          candidates[0][x] = row[x];
+          candidates[1][x] = static_cast<uint8_t>(row[x] - a);
+          candidates[2][x] = static_cast<uint8_t>(row[x] - b);
+          candidates[3][x] = static_cast<uint8_t>(row[x] - (a + b) / 2);
+          candidates[4][x] = static_cast<uint8_t>(row[x] - paeth(a, b, c));
+        }
+        size_t best = 0;
+        uint64_t best_cost = UINT64_MAX;
+        for (size_t filter = 0; filter < candidates.size(); ++filter) {
+          uint64_t cost = 0;
+          for (const auto value : candidates[filter]) {
+            cost += static_cast<uint64_t>(std::abs(static_cast<int8_t>(value)));
+          }
+          if (cost < best_cost) {
+            best = filter;
+            best_cost = cost;
+          }
+        }
+        raw[y * (stride + 1)] = static_cast<uint8_t>(best);
+        std::memcpy(raw.data() + y * (stride + 1) + 1, candidates[best].data(), stride);
+      }
+
+      std::string compressed(compressBound(static_cast<uLong>(raw.size())), '\0');
+      auto compressed_size = static_cast<uLongf>(compressed.size());
+      if (compress2(reinterpret_cast<Bytef *>(compressed.data()), &compressed_size, raw.data(),
+                    static_cast<uLong>(raw.size()), Z_BEST_COMPRESSION) != Z_OK) {
+        return std::nullopt;
+      }
+      compressed.resize(compressed_size);
+
+      std::string header(13, '\0');
+      for (size_t i = 0; i < 4; ++i) {
+        header[i] = char(bitmap.width >> (24 - 8 * i));
+        header[4 + i] = char(bitmap.height >> (24 - 8 * i));
+      }
+      header[8] = 8;
+      header[9] = png_rgba;
+
+      std::string out(reinterpret_cast<const char *>(signature), sizeof(signature));
+      append_chunk(out, "IHDR", header);
+      append_chunk(out, "IDAT", compressed);
+      append_chunk(out, "IEND", "");
+      return out;
+    }
+  }
+
+  // Convert any non-interlaced PNG into a square 8 bits RGBA PNG that image edits and variations accept:
+  //  a non square image is centered on a transparent square, which then is the area edited,
+  //  and the image is downscaled to `max_side` pixels, and further until it is under 4MB.
+  // Nothing when the image cannot be decoded, or without CPPHTTPLIB_ZLIB_SUPPORT.
+  inline std::optional<std::string> to_square_rgba_png(std::string_view data, uint32_t max_side = 1024) {
+    auto bitmap = png::decode(data);
+    if (!bitmap) {
+      return std::nullopt;
+    }
+
+    auto square = png::square(*bitmap);
+    auto side = std::min(square.width, std::max<uint32_t>(max_side, 1));
+    while (true) {
+      auto encoded = png::encode(side == square.width ? square : png::downscale(square, side));
+      if (!encoded || encoded->size() < max_image_input_size || side == 1) {
+        return encoded;
+      }
+      side = std::max<uint32_t>(1, side * 7 / 8);
+    }
+  }
+#else
+  // Decoding and encoding PNG images needs zlib: define CPPHTTPLIB_ZLIB_SUPPORT
+  inline std::optional<std::string> to_square_rgba_png(std::string_view, uint32_t = 1024) {
+    return std::nullopt;
+  }
+#endif
+}
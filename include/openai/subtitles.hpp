@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <daw/json/daw_json_link.h>
+#include "openai/enums.hpp"
+#include "openai/errors.hpp"
+#include "openai/models/audio.hpp"
+
+namespace openai {
+  namespace subtitles {
+    // "HH:MM:SS,mmm", or "HH:MM:SS.mmm" for vtt
+    inline void append_timestamp(std::string &out, double seconds, char separator) {
+      const auto ms = static_cast<int64_t>(std::llround(std::max(0.0, seconds) * 1000));
+      char buffer[32];
+      const auto n = std::snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld%c%03lld",
+                                   static_cast<long long>(ms / 3600000),
+                                   static_cast<long long>(ms / 60000 % 60),
+                                   static_cast<long long>(ms / 1000 % 60),
+                                   separator,
+                                   static_cast<long long>(ms % 1000));
+      out.append(buffer, static_cast<size_t>(n));
+    }
+
+    // Next line of `text` without its line break, removed from `text`
+    inline std::string_view next_line(std::string_view &text) {
+      const auto end = text.find('\n');
+      auto line = text.substr(0, end);
+      text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+      if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+      }
+      return line;
+    }
+
+    // "[HH:]MM:SS,mmm" or "[HH:]MM:SS.mmm", consumed from `text`
+    inline std::optional<double> parse_timestamp(std::string_view &text) {
+      double seconds = 0;
+      int fields = 0;
+      while (true) {
+        size_t digits = 0;
+        int64_t value = 0;
+        while (digits < text.size() && text[digits] >= '0' && text[digits] <= '9') {
+          value = value * 10 + (text[digits] - '0');
+          ++digits;
+        }
+        if (digits == 0) {
+          return std::nullopt;
+        }
+        text.remove_prefix(digits);
+        seconds = seconds * 60 + static_cast<double>(value);
+        ++fields;
+        if (text.empty() || text.front() != ':') {
+          break;
+        }
+        text.remove_prefix(1);
+      }
+      if (fields < 2 || fields > 3 || text.empty() || (text.front() != ',' && text.front() != '.')) {
+        return std::nullopt;
+      }
+      text.remove_prefix(1);
+
+      double scale = 0.1;
+      size_t digits = 0;
+      for (; digits < text.size() && text[digits] >= '0' && text[digits] <= '9'; ++digits, scale /= 10) {
+        seconds += (text[digits] - '0') * scale;
+      }
+      if (digits == 0) {
+        return std::nullopt;
+      }
+      text.remove_prefix(digits);
+      return seconds;
+    }
+
+    // "start --> end", followed by vtt cue settings
+    inline bool parse_timing(std::string_view line, models::AudioSegmentView &segment) {
+      auto start = parse_timestamp(line);
+      if (!start || line.substr(0, 5) != " --> ") {
+        return false;
+      }
+      line.remove_prefix(5);
+      auto end = parse_timestamp(line);
+      if (!end || (!line.empty() && line.front() != ' ' && line.front() != '\t')) {
+        return false;
+      }
+      segment.start = *start;
+      segment.end = *end;
+      return true;
+    }
+
+    // Cue text: the lines up to the next empty line, line breaks included
+    inline std::string_view cue_text(std::string_view &text) {
+      const auto *const start = text.data();
+      auto end = start;
+      while (!text.empty()) {
+        auto line = next_line(text);
+        if (line.empty()) {
+          break;
+        }
+        end = line.data() + line.size();
+      }
+      return {start, static_cast<size_t>(end - start)};
+    }
+
+    inline std::string_view trim(std::string_view text) {
+      while (!text.empty() && (text.front() == ' ' || text.front() == '\n' || text.front() == '\r')) {
+        text.remove_prefix(1);
+      }
+      while (!text.empty() && (text.back() == ' ' || text.back() == '\n' || text.back() == '\r')) {
+        text.remove_suffix(1);
+      }
+      return text;
+    }
+  }
+
+  // Render a verbose_json transcription as SubRip subtitles, the output of AUDIO_RESPONSE_FORMAT::srt
+  inline std::string to_srt(const models::VerboseAudioResponse &transcription) {
+    std::string out;
+    size_t index = 1;
+    for (const auto &segment : transcription.segments) {
+      out += std::to_string(index++);
+      out += '\n';
+      subtitles::append_timestamp(out, segment.start, ',');
+      out += " --> ";
+      subtitles::append_timestamp(out, segment.end, ',');
+      out += '\n';
+      out += subtitles::trim(segment.text);
+      out += "\n\n";
+    }
+    return out;
+  }
+
+  // Render a verbose_json transcription as WebVTT subtitles, the output of AUDIO_RESPONSE_FORMAT::vtt
+  inline std::string to_vtt(const models::VerboseAudioResponse &transcription) {
+    std::string out = "WEBVTT\n\n";
+    for (const auto &segment : transcription.segments) {
+      subtitles::append_timestamp(out, segment.start, '.');
+      out += " --> ";
+      subtitles::append_timestamp(out, segment.end, '.');
+      out += '\n';
+      out += subtitles::trim(segment.text);
+      out += "\n\n";
+    }
+    return out;
+  }
+
+  // Parse SubRip subtitles, the output of AUDIO_RESPONSE_FORMAT::srt.
+  // The texts point into `srt`. Nothing when it is not valid SubRip.
+  inline std::optional<std::vector<models::AudioSegmentView>> parse_srt(std::string_view srt) {
+    std::vector<models::AudioSegmentView> segments;
+    while (!srt.empty()) {
+      auto line = subtitles::next_line(srt);
+      if (line.empty()) {
+        continue;
+      }
+
+      models::AudioSegmentView segment{};
+      segment.id = static_cast<int64_t>(segments.size());
+      segment.avg_logprob = std::numeric_limits<double>::quiet_NaN();
+      if (!subtitles::parse_timing(subtitles::next_line(srt), segment)) {
+        return std::nullopt;
+      }
+      segment.text = subtitles::cue_text(srt);
+      segments.push_back(segment);
+    }
+    return segments;
+  }
+
+  // Parse WebVTT subtitles, the output of AUDIO_RESPONSE_FORMAT::vtt.
+  // The texts point into `vtt`. Nothing when it is not valid WebVTT.
+  inline std::optional<std::vector<models::AudioSegmentView>> parse_vtt(std::string_view vtt) {
+    if (vtt.substr(0, 3) == "\xEF\xBB\xBF") {
+      vtt.remove_prefix(3);
+    }
+    auto header = subtitles::next_line(vtt);
+    if (header.substr(0, 6) != "WEBVTT" || (header.size() > 6 && header[6] != ' ' && header[6] != '\t')) {
+      return std::nullopt;
+    }
+    // header lines
+    subtitles::cue_text(vtt);
+
+    std::vector<models::AudioSegmentView> segments;
+    while (!vtt.empty()) {
+      auto line = subtitles::next_line(vtt);
+      if (line.empty()) {
+        continue;
+      }
+      // NOTE, STYLE and REGION blocks
+      if (line.find("-->") == std::string_view::npos) {
+        if (line.substr(0, 4) == "NOTE" || line.substr(0, 5) == "STYLE" || line.substr(0, 6) == "REGION") {
+          subtitles::cue_text(vtt);
+          continue;
+        }
+        // cue identifier
+        line = subtitles::next_line(vtt);
+      }
+
+      models::AudioSegmentView segment{};
+      segment.id = static_cast<int64_t>(segments.size());
+      segment.avg_logprob = std::numeric_limits<double>::quiet_NaN();
+      if (!subtitles::parse_timing(line, segment)) {
+        return std::nullopt;
+      }
+      segment.text = subtitles::cue_text(vtt);
+      segments.push_back(segment);
+    }
+    return segments;
+  }
+
+  // Parse an audio transcription or translation body into timed segments pointing into it.
+  // `format` must be verbose_json, srt or vtt.
+  inline Expected<std::unique_ptr<models::Retained<models::VerboseAudioResponseView>>> parse_transcript(
+      std::string body,
+      AUDIO_RESPONSE_FORMAT format,
+      const std::string &path = ""
+  ) {
+    auto retained = std::make_unique<models::Retained<models::VerboseAudioResponseView>>(std::move(body));
+    // built only when the body cannot be parsed
+    const auto parse_error = [&](std::string detail, bool with_body) {
+      Error error;
+      error.kind = error_parse;
+      error.status = 200;
+      error.path = path;
+      error.detail = std::move(detail);
+      if (with_body) {
+        error.body = retained->body;
+      }
+      return error;
+    };
+
+    std::optional<std::vector<models::AudioSegmentView>> segments;
+    switch (format) {
+      case verbose_json:
+        try {
+          retained->value = daw::json::from_json<models::VerboseAudioResponseView>(
+              retained->body,
+              daw::json::options::parse_flags<daw::json::options::UseExactMappingsByDefault::no,
+                                              daw::json::options::CheckedParseMode::no>);
+        } catch (const std::exception &exc) {
+          return parse_error(exc.what(), true);
+        }
+        return retained;
+      case srt:
+        segments = parse_srt(retained->body);
+        break;
+      case vtt:
+        segments = parse_vtt(retained->body);
+        break;
+      default:
+        return parse_error(std::string("no segments in the ") + to_str(format) + " format", false);
+    }
+
+    if (!segments) {
+      return parse_error(std::string("invalid ") + to_str(format) + " subtitles", true);
+    }
+    retained->value.duration = segments->empty() ? 0 : segments->back().end;
+    retained->value.segments = std::move(*segments);
+    return retained;
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace openai {
+  // Cheap estimate of the number of GPT tokens in `text`, without a BPE vocabulary.
+  // Letters and digits are counted as one token every 4 characters of a word,
+  //  every punctuation character as one token, whitespace is merged with the next word
+  //  and multi-byte UTF-8 characters count as one token each.
+  // Good enough to enforce limits with a margin, use the real tokenizer for exact counts.
+  inline size_t estimate_tokens(std::string_view text) {
+    size_t tokens = 0;
+    size_t word = 0;
+
+    for (size_t i = 0; i < text.size(); ++i) {
+      const auto c = static_cast<unsigned char>(text[i]);
+      const bool alnum = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+      if (alnum) {
+        ++word;
+        continue;
+      }
+
+      tokens += (word + 3) / 4;
+      word = 0;
+      if (c == ' ' || c == '\t') {
+        continue;
+      }
+      if (c >= 0x80) {
+        // skip the continuation bytes of the character
+        while (i + 1 < text.size() && (static_cast<unsigned char>(text[i + 1]) & 0xC0) == 0x80) {
+          ++i;
+        }
+      }
+      ++tokens;
+    }
+    return tokens + (word + 3) / 4;
+  }
+}